@@ -0,0 +1,110 @@
+#include <QApplication>
+#include <QWidget>
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include "benchreport.h"
+#include "memoryaccounting.h"
+
+
+static QElapsedTimer s_clock;
+
+static int countObjects(const QObject * obj)
+{
+    int count = 1;
+    foreach (const QObject * child, obj->children())
+        count += countObjects(child);
+    return count;
+}
+
+BenchSample BenchSample::take()
+{
+    if (!s_clock.isValid())
+        s_clock.start();
+
+    QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete);
+    QCoreApplication::processEvents();
+
+    BenchSample s;
+    s.usec = s_clock.nsecsElapsed() / 1000;
+    s.rssKb = MemoryAccounting::residentKb();
+    // top level widgets are not children of qApp
+    s.objects = countObjects(qApp);
+    foreach (QWidget * w, QApplication::topLevelWidgets())
+        s.objects += countObjects(w);
+    s.widgets = QApplication::allWidgets().count();
+    return s;
+}
+
+
+void BenchReport::add(const QString & suite, const QString & operation, int n,
+                      const BenchSample & before, const BenchSample & after)
+{
+    Metrics m;
+    m["wall_ms"] = (after.usec - before.usec) / 1000.0;
+    m["rss_growth_kb"] = after.rssKb - before.rssKb;
+    m["rss_kb"] = after.rssKb;
+    m["qobjects"] = after.objects;
+    m["qobjects_delta"] = after.objects - before.objects;
+    m["qwidgets"] = after.widgets;
+    m["qwidgets_delta"] = after.widgets - before.widgets;
+    add(suite, operation, n, m);
+}
+
+void BenchReport::add(const QString & suite, const QString & operation, int n,
+                      const Metrics & metrics)
+{
+    Row r;
+    r.suite = suite;
+    r.operation = operation;
+    r.n = n;
+    r.metrics = metrics;
+    m_rows.append(r);
+
+    qDebug() << "bench:" << suite << operation << n << metrics;
+}
+
+bool BenchReport::write(const QString & fname) const
+{
+    QFile f;
+    if (fname.isEmpty())
+    {
+        if (!f.open(stdout, QIODevice::WriteOnly | QIODevice::Text))
+            return false;
+    }
+    else
+    {
+        f.setFileName(fname);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        {
+            qDebug() << "BenchReport: cannot write to" << fname;
+            return false;
+        }
+    }
+
+    QTextStream out(&f);
+    out << "{\"version\":\"" << STR_VERSION << "\","
+        << "\"qt\":\"" << qVersion() << "\","
+        << "\"date\":\"" << QDateTime::currentDateTime().toString(Qt::ISODate) << "\","
+        << "\"results\":[\n";
+    for (int i = 0; i < m_rows.count(); ++i)
+    {
+        const Row & r = m_rows.at(i);
+        // suite and operation names are ours - no escaping needed
+        out << "{\"suite\":\"" << r.suite << "\","
+            << "\"operation\":\"" << r.operation << "\","
+            << "\"n\":" << r.n;
+        Metrics::const_iterator it = r.metrics.constBegin();
+        while (it != r.metrics.constEnd())
+        {
+            out << ",\"" << it.key() << "\":" << QString::number(it.value(), 'g', 12);
+            ++it;
+        }
+        out << "}" << (i < m_rows.count() - 1 ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    return true;
+}
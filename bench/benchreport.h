@@ -0,0 +1,55 @@
+#ifndef BENCHREPORT_H
+#define BENCHREPORT_H
+
+#include <QString>
+#include <QList>
+#include <QMap>
+
+
+/*! \brief Process-wide numbers taken before and after a measured operation.
+ */
+struct BenchSample
+{
+    qint64 usec;
+    qint64 rssKb;
+    int objects;
+    int widgets;
+
+    //! Flush deferred deletes and take the numbers now
+    static BenchSample take();
+};
+
+
+/*! \brief Results of a qterminal-bench run.
+
+Every measured operation adds one row. The rows are written as JSON
+so the numbers can be compared across releases by scripts.
+*/
+class BenchReport
+{
+    public:
+        typedef QMap<QString,double> Metrics;
+
+        /*! Add wall time, RSS growth and QObject/QWidget counts
+            of an operation done between \a before and \a after.
+         */
+        void add(const QString & suite, const QString & operation, int n,
+                 const BenchSample & before, const BenchSample & after);
+        void add(const QString & suite, const QString & operation, int n,
+                 const Metrics & metrics);
+
+        //! Write the JSON to \a fname or to stdout if it's empty
+        bool write(const QString & fname) const;
+
+    private:
+        struct Row
+        {
+            QString suite;
+            QString operation;
+            int n;
+            Metrics metrics;
+        };
+        QList<Row> m_rows;
+};
+
+#endif
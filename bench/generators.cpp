@@ -0,0 +1,165 @@
+#include <QByteArray>
+
+#include <stdio.h>
+
+#include "generators.h"
+
+
+static const char * WORDS[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+    "elit", "make[2]:", "Building", "CXX", "object", "src/termwidget.cpp.o",
+    "warning:", "unused", "variable", "PASSED", "FAILED", "0x7ffd5e8c", "=>"
+};
+static const int WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+// deterministic - the same output in every run
+static unsigned int s_seed = 1;
+static unsigned int nextRandom()
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return (s_seed / 65536) % 32768;
+}
+
+static const char * randomWord()
+{
+    return WORDS[nextRandom() % WORD_COUNT];
+}
+
+
+//! plain log output, 80 columns
+static void asciiChunk(QByteArray & buf)
+{
+    QByteArray line;
+    while (line.size() < 72)
+    {
+        line += randomWord();
+        line += ' ';
+    }
+    buf += line.left(79);
+    buf += '\n';
+}
+
+//! every word has its own color and attributes, like compiler output
+static void sgrChunk(QByteArray & buf)
+{
+    for (int i = 0; i < 10; ++i)
+    {
+        switch (nextRandom() % 3)
+        {
+            case 0:
+                buf += "\033[38;5;" + QByteArray::number(nextRandom() % 256) + 'm';
+                break;
+            case 1:
+                buf += "\033[1;" + QByteArray::number(30 + nextRandom() % 8) + 'm';
+                break;
+            default:
+                buf += "\033[48;2;" + QByteArray::number(nextRandom() % 256) + ';'
+                       + QByteArray::number(nextRandom() % 256) + ';'
+                       + QByteArray::number(nextRandom() % 256) + 'm';
+        }
+        buf += randomWord();
+        buf += ' ';
+    }
+    buf += "\033[0m\n";
+}
+
+//! full screen redraw of a 80x24 TUI (top, htop, ncurses apps)
+static void tuiChunk(QByteArray & buf)
+{
+    static int frame = 0;
+    ++frame;
+    buf += "\033[H\033[7m";
+    buf += QByteArray("frame ").append(QByteArray::number(frame)).leftJustified(80, ' ');
+    buf += "\033[0m";
+    for (int row = 2; row <= 24; ++row)
+    {
+        buf += "\033[" + QByteArray::number(row) + ";1H";
+        buf += QByteArray::number(nextRandom()).rightJustified(6, ' ');
+        buf += "  ";
+        buf += randomWord();
+        buf += "\033[K";
+    }
+}
+
+//! double width CJK characters, 3 bytes of UTF-8 each
+static void cjkChunk(QByteArray & buf)
+{
+    for (int i = 0; i < 39; ++i)
+    {
+        unsigned int cp = 0x4E00 + nextRandom() % 0x5000;
+        buf += char(0xE0 | (cp >> 12));
+        buf += char(0x80 | ((cp >> 6) & 0x3F));
+        buf += char(0x80 | (cp & 0x3F));
+    }
+    buf += '\n';
+}
+
+//! a line wrapped over many rows, like minified JSON or a long command
+static void longLineChunk(QByteArray & buf)
+{
+    QByteArray line;
+    while (line.size() < 20000)
+    {
+        line += randomWord();
+        line += ',';
+    }
+    buf += line;
+    buf += '\n';
+}
+
+
+typedef void (*ChunkFunc)(QByteArray &);
+
+struct Generator
+{
+    const char * name;
+    ChunkFunc chunk;
+};
+
+static const Generator GENERATORS[] = {
+    { "ascii",     asciiChunk },
+    { "sgr",       sgrChunk },
+    { "tui",       tuiChunk },
+    { "cjk",       cjkChunk },
+    { "longlines", longLineChunk }
+};
+static const int GENERATOR_COUNT = sizeof(GENERATORS) / sizeof(GENERATORS[0]);
+
+
+QStringList Generators::names()
+{
+    QStringList ret;
+    for (int i = 0; i < GENERATOR_COUNT; ++i)
+        ret << GENERATORS[i].name;
+    return ret;
+}
+
+int Generators::run(const QString & name, qint64 bytes)
+{
+    ChunkFunc chunk = 0;
+    for (int i = 0; i < GENERATOR_COUNT; ++i)
+    {
+        if (name == GENERATORS[i].name)
+            chunk = GENERATORS[i].chunk;
+    }
+    if (!chunk)
+    {
+        fprintf(stderr, "Unknown generator: %s\n", name.toLocal8Bit().constData());
+        return 1;
+    }
+
+    QByteArray buf;
+    while (bytes > 0)
+    {
+        while (buf.size() < 65536)
+            chunk(buf);
+
+        int len = (int)qMin<qint64>(buf.size(), bytes);
+        if (fwrite(buf.constData(), 1, len, stdout) != (size_t)len)
+            return 1;
+        bytes -= len;
+        buf.clear();
+    }
+    fflush(stdout);
+    return 0;
+}
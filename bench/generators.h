@@ -0,0 +1,24 @@
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <QStringList>
+
+
+/*! \brief Synthetic terminal output.
+
+qterminal-bench starts itself with --generate as the "shell" of the
+measured terminal so the output goes through a real pty. Every
+generator writes exactly the requested amount of bytes to stdout
+and the content is the same in each run.
+*/
+namespace Generators
+{
+    QStringList names();
+
+    /*! Write \a bytes of \a name output to stdout. Returns the process
+        exit code - non zero for an unknown generator.
+     */
+    int run(const QString & name, qint64 bytes);
+}
+
+#endif
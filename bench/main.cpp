@@ -0,0 +1,139 @@
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QDebug>
+
+#include <stdio.h>
+#include <getopt.h>
+#include <stdlib.h>
+
+#include "benchreport.h"
+#include "scaling.h"
+#include "throughput.h"
+#include "generators.h"
+#include "properties.h"
+
+
+const char* const short_options = "hc:o:s:e:g:m:";
+
+// long-only options
+enum {
+    GENERATE_OPTION = 256
+};
+
+const struct option long_options[] = {
+    {"help",    0, NULL, 'h'},
+    {"counts",  1, NULL, 'c'},
+    {"output",  1, NULL, 'o'},
+    {"suite",   1, NULL, 's'},
+    {"shell",   1, NULL, 'e'},
+    {"generators", 1, NULL, 'g'},
+    {"megabytes",  1, NULL, 'm'},
+    {"generate",   1, NULL, GENERATE_OPTION},
+    {NULL,      0, NULL,  0}
+};
+
+void print_usage_and_exit(int code)
+{
+    printf("qterminal-bench %s\n", STR_VERSION);
+    puts("Usage: qterminal-bench [OPTION]...\n");
+    puts("  -c,  --counts <n,n,...>   Terminal counts to measure (default 1,10,50,100,250,500)");
+    puts("  -e,  --shell <program>    Shell started in the terminals (default /bin/sh)");
+    puts("  -g,  --generators <g,...> Throughput workloads (default all):");
+    printf("                            %s\n", Generators::names().join(", ").toLocal8Bit().constData());
+    puts("  -h,  --help               Print this help");
+    puts("  -m,  --megabytes <n>      Output size of each throughput workload (default 64)");
+    puts("  -o,  --output <file>      Write JSON results to file instead of stdout");
+    puts("  -s,  --suite <name>       Run only this suite: scaling, throughput");
+    puts("       --generate <g>       Write workload <g> to stdout and exit");
+    puts("\nThe benchmark runs on the offscreen platform unless QT_QPA_PLATFORM is set.");
+    exit(code);
+}
+
+int main(int argc, char *argv[])
+{
+    QList<int> counts;
+    counts << 1 << 10 << 50 << 100 << 250 << 500;
+    QString output;
+    QString suite;
+    QString shell("/bin/sh");
+    QStringList generators = Generators::names();
+    int megabytes = 64;
+    QString generate;
+
+    int next_option;
+    do {
+        next_option = getopt_long(argc, argv, short_options, long_options, NULL);
+        switch(next_option)
+        {
+            case 'h':
+                print_usage_and_exit(0);
+            case 'c':
+                counts.clear();
+                foreach (QString c, QString(optarg).split(',', QString::SkipEmptyParts))
+                {
+                    if (c.toInt() > 0)
+                        counts.append(c.toInt());
+                }
+                break;
+            case 'o':
+                output = QString(optarg);
+                break;
+            case 's':
+                suite = QString(optarg);
+                break;
+            case 'e':
+                shell = QString(optarg);
+                break;
+            case 'g':
+                generators = QString(optarg).split(',', QString::SkipEmptyParts);
+                break;
+            case 'm':
+                megabytes = qMax(1, atoi(optarg));
+                break;
+            case GENERATE_OPTION:
+                generate = QString(optarg);
+                break;
+            case '?':
+                print_usage_and_exit(1);
+        }
+    }
+    while(next_option != -1);
+
+    // we are the "shell" of a throughput benchmark terminal
+    if (!generate.isEmpty())
+        return Generators::run(generate, (qint64)megabytes * 1024 * 1024);
+
+    if (!suite.isEmpty() && suite != "scaling" && suite != "throughput")
+        print_usage_and_exit(1);
+
+    // no windows on the screen; Qt4 has no offscreen platform - use Xvfb there
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    setenv("TERM", "xterm", 1);
+
+    QApplication::setApplicationName("qterminal-bench");
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+    QApplication app(argc, argv);
+    // removing the last tab closes its window
+    app.setQuitOnLastWindowClosed(false);
+
+    // never touch the user's settings
+    QString settingsFile = QDir::temp().filePath(QString("qterminal-bench-%1.ini")
+                                                 .arg(QCoreApplication::applicationPid()));
+    Properties::Instance(settingsFile)->loadSettings();
+    Properties::Instance()->shell = shell;
+    Properties::Instance()->askOnExit = false;
+
+    BenchReport report;
+    if (suite.isEmpty() || suite == "scaling")
+        runScalingBenchmarks(report, counts);
+    if (suite.isEmpty() || suite == "throughput")
+        runThroughputBenchmarks(report, generators, megabytes);
+
+    bool ok = report.write(output);
+
+    QFile::remove(settingsFile);
+    return ok ? 0 : 1;
+}
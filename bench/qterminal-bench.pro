@@ -0,0 +1,19 @@
+TARGET = qterminal-bench
+TEMPLATE = app
+# qt5 only. Please use cmake -DBUILD_BENCHMARKS=ON - it's an official build tool for this software
+QT += widgets network
+
+CONFIG += link_pkgconfig
+PKGCONFIG += qtermwidget5 zlib
+
+DEFINES += STR_VERSION=\\\"0.5.0\\\" HAVE_ZLIB
+
+# all of qterminal but its main()
+SOURCES += $$files(*.cpp) $$files(../src/*.cpp)
+SOURCES -= ../src/main.cpp
+HEADERS += $$files(*.h) $$files(../src/*.h)
+
+INCLUDEPATH += ../src
+
+RESOURCES += ../src/icons.qrc
+FORMS += $$files(../src/forms/*.ui)
@@ -0,0 +1,99 @@
+#include <QApplication>
+#include <QDir>
+
+#include "scaling.h"
+#include "benchreport.h"
+#include "mainwindow.h"
+#include "tabwidget.h"
+#include "termwidgetholder.h"
+
+
+static const char * SUITE = "scaling";
+
+
+static MainWindow * newWindow()
+{
+    MainWindow * w = new MainWindow(QDir::homePath(), QString(), false);
+    w->show();
+    return w;
+}
+
+static TabWidget * tabsOf(MainWindow * w)
+{
+    return w->findChild<TabWidget*>("consoleTabulator");
+}
+
+
+static void windows(BenchReport & report, int n)
+{
+    QList<MainWindow*> list;
+
+    BenchSample before = BenchSample::take();
+    for (int i = 0; i < n; ++i)
+        list.append(newWindow());
+    BenchSample after = BenchSample::take();
+    report.add(SUITE, "MainWindow", n, before, after);
+
+    before = after;
+    qDeleteAll(list);
+    after = BenchSample::take();
+    report.add(SUITE, "~MainWindow", n, before, after);
+}
+
+static void tabs(BenchReport & report, int n)
+{
+    MainWindow * w = newWindow();
+    TabWidget * tabs = tabsOf(w);
+
+    // MainWindow has one tab already
+    BenchSample before = BenchSample::take();
+    for (int i = 1; i < n; ++i)
+        tabs->addNewTab();
+    BenchSample after = BenchSample::take();
+    report.add(SUITE, "TabWidget::addNewTab", n, before, after);
+
+    // the last tab would close the window
+    before = after;
+    while (tabs->count() > 1)
+        tabs->removeTab(tabs->count() - 1);
+    after = BenchSample::take();
+    report.add(SUITE, "TabWidget::removeTab", n, before, after);
+
+    delete w;
+}
+
+static void splits(BenchReport & report, int n)
+{
+    MainWindow * w = newWindow();
+    TermWidgetHolder * holder = tabsOf(w)->terminalHolder();
+
+    BenchSample before = BenchSample::take();
+    for (int i = 1; i < n; ++i)
+    {
+        if (i % 2)
+            holder->splitHorizontal(holder->currentTerminal());
+        else
+            holder->splitVertical(holder->currentTerminal());
+    }
+    BenchSample after = BenchSample::take();
+    report.add(SUITE, "TermWidgetHolder::split", n, before, after);
+
+    before = after;
+    for (int i = 1; i < n; ++i)
+        holder->splitCollapse(holder->currentTerminal());
+    after = BenchSample::take();
+    report.add(SUITE, "TermWidgetHolder::splitCollapse", n, before, after);
+
+    delete w;
+}
+
+
+void runScalingBenchmarks(BenchReport & report, const QList<int> & counts)
+{
+    foreach (int n, counts)
+    {
+        windows(report, n);
+        tabs(report, n);
+        splits(report, n);
+    }
+}
@@ -0,0 +1,13 @@
+#ifndef SCALING_H
+#define SCALING_H
+
+#include <QList>
+
+class BenchReport;
+
+/*! Tabs, splits and windows with N terminals for each N of \a counts.
+    Every step is measured separately; see BenchReport::add().
+ */
+void runScalingBenchmarks(BenchReport & report, const QList<int> & counts);
+
+#endif
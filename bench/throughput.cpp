@@ -0,0 +1,137 @@
+#include <QApplication>
+#include <QDir>
+#include <QEvent>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include "throughput.h"
+#include "benchreport.h"
+#include "termwidget.h"
+
+
+static const char * SUITE = "throughput";
+//! give up on a generator after 10 minutes
+static const int TIMEOUT = 10 * 60 * 1000;
+
+
+//! Counts paint events of the terminal display
+class PaintCounter : public QObject
+{
+public:
+    PaintCounter() : frames(0) {}
+
+    int frames;
+
+protected:
+    bool eventFilter(QObject *, QEvent * event)
+    {
+        if (event->type() == QEvent::Paint)
+            ++frames;
+        return false;
+    }
+};
+
+
+/*! Ticks every millisecond. Every late tick is a time the event loop
+    was busy - the user would see a frozen window.
+ */
+class StallProbe : public QObject
+{
+public:
+    void start()
+    {
+        m_stalls.clear();
+        m_clock.start();
+        m_last = 0;
+        m_timer = startTimer(1);
+    }
+    void stop()
+    {
+        killTimer(m_timer);
+    }
+
+    //! milliseconds
+    double percentile(double p)
+    {
+        if (m_stalls.isEmpty())
+            return 0;
+        qSort(m_stalls);
+        int i = qMin(m_stalls.count() - 1, (int)(p * m_stalls.count()));
+        return m_stalls.at(i) / 1000.0;
+    }
+
+protected:
+    void timerEvent(QTimerEvent *)
+    {
+        qint64 now = m_clock.nsecsElapsed() / 1000;
+        m_stalls.append(qMax<qint64>(0, now - m_last - 1000));
+        m_last = now;
+    }
+
+private:
+    QElapsedTimer m_clock;
+    qint64 m_last;
+    int m_timer;
+    QVector<qint64> m_stalls;
+};
+
+
+static void throughput(BenchReport & report, const QString & generator, int megabytes)
+{
+    // qterminal-bench is the "shell" - see main(). Its path may contain
+    // spaces so it is not passed as one command line
+    QStringList args;
+    args << "--generate" << generator << "--megabytes" << QString::number(megabytes);
+
+    BenchSample before = BenchSample::take();
+
+    // nothing is read from the pty until the event loop runs below
+    TermWidgetImpl * term = new TermWidgetImpl(QDir::homePath(), QCoreApplication::applicationFilePath(),
+                                               0, args);
+    term->resize(800, 600);
+
+    PaintCounter counter;
+    if (term->display())
+        term->display()->installEventFilter(&counter);
+    term->show();
+
+    QEventLoop loop;
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    QObject::connect(term, SIGNAL(finished()), &loop, SLOT(quit()));
+    QObject::connect(&timeout, SIGNAL(timeout()), &loop, SLOT(quit()));
+
+    StallProbe probe;
+    QElapsedTimer clock;
+    clock.start();
+    probe.start();
+    timeout.start(TIMEOUT);
+    loop.exec();
+    probe.stop();
+    double seconds = clock.nsecsElapsed() / 1e9;
+    bool completed = timeout.isActive();
+
+    BenchSample after = BenchSample::take();
+    delete term;
+
+    BenchReport::Metrics m;
+    m["completed"] = completed ? 1 : 0;
+    m["seconds"] = seconds;
+    m["mb_per_s"] = seconds > 0 ? megabytes / seconds : 0;
+    m["frames"] = counter.frames;
+    m["stall_p50_ms"] = probe.percentile(0.50);
+    m["stall_p99_ms"] = probe.percentile(0.99);
+    m["stall_max_ms"] = probe.percentile(1.0);
+    m["rss_growth_kb"] = after.rssKb - before.rssKb;
+    report.add(SUITE, generator, megabytes, m);
+}
+
+
+void runThroughputBenchmarks(BenchReport & report, const QStringList & generators, int megabytes)
+{
+    foreach (QString g, generators)
+        throughput(report, g, megabytes);
+}
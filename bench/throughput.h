@@ -0,0 +1,14 @@
+#ifndef THROUGHPUT_H
+#define THROUGHPUT_H
+
+#include <QStringList>
+
+class BenchReport;
+
+/*! Stream \a megabytes of each generator's output through a real pty
+    into an offscreen TermWidgetImpl. Reports MB/s, painted frames and
+    event loop stalls; see Generators for the workloads.
+ */
+void runThroughputBenchmarks(BenchReport & report, const QStringList & generators, int megabytes);
+
+#endif
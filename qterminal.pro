@@ -1,12 +1,12 @@
 TARGET = qterminal
 TEMPLATE = app
 # qt5 only. Please use cmake - it's an official build tool for this software
-QT += widgets
+QT += widgets network
 
 CONFIG += link_pkgconfig
-PKGCONFIG += qtermwidget5
+PKGCONFIG += qtermwidget5 zlib
 
-DEFINES += STR_VERSION=\\\"0.5.0\\\"
+DEFINES += STR_VERSION=\\\"0.5.0\\\" HAVE_ZLIB
 
 SOURCES += $$files(src/*.cpp)
 HEADERS += $$files(src/*.h)
@@ -0,0 +1,135 @@
+
+#include <QApplication>
+#include <QVector>
+
+#include "actionregistry.h"
+#include "config.h"
+
+#ifndef PASTE_SELECTION_SHORTCUT
+#define PASTE_SELECTION_SHORTCUT 0
+#endif
+
+
+static const ActionRegistry::Descriptor s_actions[] = {
+    { ActionRegistry::AddTab, ADD_TAB, QT_TRANSLATE_NOOP("MainWindow", "New Tab"),
+      "list-add", ADD_TAB_SHORTCUT, ActionRegistry::FileMenu, false, false },
+    { ActionRegistry::CloseTab, CLOSE_TAB, QT_TRANSLATE_NOOP("MainWindow", "Close Tab"),
+      "list-remove", CLOSE_TAB_SHORTCUT, ActionRegistry::FileMenu, false, false },
+    { ActionRegistry::NewWindow, NEW_WINDOW, QT_TRANSLATE_NOOP("MainWindow", "New Window"),
+      "window-new", NEW_WINDOW_SHORTCUT, ActionRegistry::FileMenu, false, false },
+    // no default shortcuts - they'd collide with eg. mc and they are not used often
+    { ActionRegistry::SaveSession, SAVE_SESSION, QT_TRANSLATE_NOOP("MainWindow", "Save Session..."),
+      "document-save", 0, ActionRegistry::FileMenu, true, false },
+    { ActionRegistry::LoadSession, LOAD_SESSION, QT_TRANSLATE_NOOP("MainWindow", "Load Session..."),
+      "document-open", 0, ActionRegistry::FileMenu, false, false },
+    { ActionRegistry::Preferences, PREFERENCES, QT_TRANSLATE_NOOP("MainWindow", "&Preferences..."),
+      0, 0, ActionRegistry::FileMenu, true, false },
+    { ActionRegistry::Quit, QUIT, QT_TRANSLATE_NOOP("MainWindow", "&Quit"),
+      "application-exit", 0, ActionRegistry::FileMenu, true, false },
+
+    { ActionRegistry::ClearTerminal, CLEAR_TERMINAL, QT_TRANSLATE_NOOP("MainWindow", "Clear Current Tab"),
+      "edit-clear", CLEAR_TERMINAL_SHORTCUT, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::TabNext, TAB_NEXT, QT_TRANSLATE_NOOP("MainWindow", "Next Tab"),
+      "go-next", TAB_NEXT_SHORTCUT, ActionRegistry::ActionsMenu, true, false },
+    { ActionRegistry::TabPrev, TAB_PREV, QT_TRANSLATE_NOOP("MainWindow", "Previous Tab"),
+      "go-previous", TAB_PREV_SHORTCUT, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::MoveLeft, MOVE_LEFT, QT_TRANSLATE_NOOP("MainWindow", "Move Tab Left"),
+      0, MOVE_LEFT_SHORTCUT, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::MoveRight, MOVE_RIGHT, QT_TRANSLATE_NOOP("MainWindow", "Move Tab Right"),
+      0, MOVE_RIGHT_SHORTCUT, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::SplitHorizontal, SPLIT_HORIZONTAL, QT_TRANSLATE_NOOP("MainWindow", "Split Terminal Horizontally"),
+      0, 0, ActionRegistry::ActionsMenu, true, false },
+    { ActionRegistry::SplitVertical, SPLIT_VERTICAL, QT_TRANSLATE_NOOP("MainWindow", "Split Terminal Vertically"),
+      0, 0, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::SubCollapse, SUB_COLLAPSE, QT_TRANSLATE_NOOP("MainWindow", "Collapse Subterminal"),
+      0, 0, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::SubNext, SUB_NEXT, QT_TRANSLATE_NOOP("MainWindow", "Next Subterminal"),
+      "go-up", SUB_NEXT_SHORTCUT, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::SubPrev, SUB_PREV, QT_TRANSLATE_NOOP("MainWindow", "Previous Subterminal"),
+      "go-down", SUB_PREV_SHORTCUT, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::SubLeft, SUB_LEFT, QT_TRANSLATE_NOOP("MainWindow", "Subterminal on the Left"),
+      0, 0, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::SubRight, SUB_RIGHT, QT_TRANSLATE_NOOP("MainWindow", "Subterminal on the Right"),
+      0, 0, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::SubUp, SUB_UP, QT_TRANSLATE_NOOP("MainWindow", "Subterminal Above"),
+      0, 0, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::SubDown, SUB_DOWN, QT_TRANSLATE_NOOP("MainWindow", "Subterminal Below"),
+      0, 0, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::SynchronizeInput, SYNCHRONIZE_INPUT, QT_TRANSLATE_NOOP("MainWindow", "Synchronize Input"),
+      0, 0, ActionRegistry::ActionsMenu, false, true },
+    { ActionRegistry::Find, FIND, QT_TRANSLATE_NOOP("MainWindow", "Find..."),
+      "edit-find", FIND_SHORTCUT, ActionRegistry::ActionsMenu, true, false },
+    { ActionRegistry::FindAll, FIND_ALL, QT_TRANSLATE_NOOP("MainWindow", "Find in All Tabs..."),
+      "edit-find", FIND_ALL_SHORTCUT, ActionRegistry::ActionsMenu, false, false },
+    { ActionRegistry::CommandPalette, COMMAND_PALETTE, QT_TRANSLATE_NOOP("MainWindow", "Command Palette..."),
+      0, COMMAND_PALETTE_SHORTCUT, ActionRegistry::ActionsMenu, false, false },
+
+    // Copy and Paste are in the Edit menu and in the terminal context menu
+    { ActionRegistry::CopySelection, COPY_SELECTION, QT_TRANSLATE_NOOP("MainWindow", "Copy Selection"),
+      "edit-copy", COPY_SELECTION_SHORTCUT, ActionRegistry::EditMenu, false, false },
+    { ActionRegistry::PasteClipboard, PASTE_CLIPBOARD, QT_TRANSLATE_NOOP("MainWindow", "Paste Clipboard"),
+      "edit-paste", PASTE_CLIPBOARD_SHORTCUT, ActionRegistry::EditMenu, false, false },
+    { ActionRegistry::PasteSelection, PASTE_SELECTION, QT_TRANSLATE_NOOP("MainWindow", "Paste Selection"),
+      "edit-paste", PASTE_SELECTION_SHORTCUT, ActionRegistry::EditMenu, false, false },
+    { ActionRegistry::ZoomIn, ZOOM_IN, QT_TRANSLATE_NOOP("MainWindow", "Zoom in"),
+      "zoom-in", ZOOM_IN_SHORTCUT, ActionRegistry::EditMenu, false, false },
+    { ActionRegistry::ZoomOut, ZOOM_OUT, QT_TRANSLATE_NOOP("MainWindow", "Zoom out"),
+      "zoom-out", ZOOM_OUT_SHORTCUT, ActionRegistry::EditMenu, false, false },
+    { ActionRegistry::ZoomReset, ZOOM_RESET, QT_TRANSLATE_NOOP("MainWindow", "Zoom reset"),
+      "zoom-original", ZOOM_RESET_SHORTCUT, ActionRegistry::EditMenu, false, false },
+
+    // main window only - not in menu to keep toggle working when the menu is hidden
+    { ActionRegistry::ToggleMenu, TOGGLE_MENU, QT_TRANSLATE_NOOP("MainWindow", "Toggle Menu"),
+      0, TOGGLE_MENU_SHORTCUT, ActionRegistry::NoMenu, false, false },
+
+    { ActionRegistry::HideWindowBorders, HIDE_WINDOW_BORDERS, QT_TRANSLATE_NOOP("MainWindow", "Hide Window Borders"),
+      0, 0, ActionRegistry::ViewMenu, false, true },
+    { ActionRegistry::ShowTabBar, SHOW_TAB_BAR, QT_TRANSLATE_NOOP("MainWindow", "Show Tab Bar"),
+      0, 0, ActionRegistry::ViewMenu, false, true },
+    // it's QDockWidget::toggleViewAction() in MainWindow. Only its shortcut is handled here.
+    { ActionRegistry::ToggleBookmarks, TOGGLE_BOOKMARKS, QT_TRANSLATE_NOOP("MainWindow", "Bookmarks"),
+      0, TOGGLE_BOOKMARKS_SHORTCUT, ActionRegistry::ViewMenu, false, true },
+    { ActionRegistry::MemoryUsage, MEMORY_USAGE, QT_TRANSLATE_NOOP("MainWindow", "Memory Usage..."),
+      0, 0, ActionRegistry::ViewMenu, true, false }
+};
+
+
+const ActionRegistry::Descriptor & ActionRegistry::descriptor(int id)
+{
+    Q_ASSERT(id >= 0 && id < ActionCount);
+    Q_ASSERT(s_actions[id].id == id);
+    return s_actions[id];
+}
+
+QString ActionRegistry::text(int id)
+{
+    static QVector<QString> texts;
+    if (texts.isEmpty())
+    {
+        texts.resize(ActionCount);
+        for (int i = 0; i < ActionCount; ++i)
+            texts[i] = QApplication::translate("MainWindow", s_actions[i].text);
+    }
+    return texts.at(id);
+}
+
+QIcon ActionRegistry::icon(int id)
+{
+    static QVector<QIcon> icons;
+    if (icons.isEmpty())
+    {
+        icons.resize(ActionCount);
+        for (int i = 0; i < ActionCount; ++i)
+        {
+            if (s_actions[i].icon)
+                icons[i] = QIcon::fromTheme(s_actions[i].icon);
+        }
+    }
+    return icons.at(id);
+}
+
+QKeySequence ActionRegistry::defaultShortcut(int id)
+{
+    const char * shortcut = descriptor(id).shortcut;
+    return shortcut ? QKeySequence::fromString(shortcut) : QKeySequence();
+}
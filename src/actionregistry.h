@@ -0,0 +1,90 @@
+#ifndef ACTIONREGISTRY_H
+#define ACTIONREGISTRY_H
+
+#include <QIcon>
+#include <QKeySequence>
+
+
+/*! \brief Declarative description of all MainWindow actions.
+
+One static table describes every action: its settings key (see config.h),
+menu text, icon, default shortcut and menu placement. The table as well
+as the translated texts and icons are shared by all windows - a new
+MainWindow only instantiates its QActions from it. Current shortcuts
+are kept in Properties::shortcuts, indexed by ActionId.
+*/
+class ActionRegistry
+{
+    public:
+        //! Keep the order in sync with the table in actionregistry.cpp
+        enum ActionId {
+            AddTab = 0,
+            CloseTab,
+            NewWindow,
+            SaveSession,
+            LoadSession,
+            Preferences,
+            Quit,
+            ClearTerminal,
+            TabNext,
+            TabPrev,
+            MoveLeft,
+            MoveRight,
+            SplitHorizontal,
+            SplitVertical,
+            SubCollapse,
+            SubNext,
+            SubPrev,
+            SubLeft,
+            SubRight,
+            SubUp,
+            SubDown,
+            SynchronizeInput,
+            Find,
+            FindAll,
+            CommandPalette,
+            CopySelection,
+            PasteClipboard,
+            PasteSelection,
+            ZoomIn,
+            ZoomOut,
+            ZoomReset,
+            ToggleMenu,
+            HideWindowBorders,
+            ShowTabBar,
+            ToggleBookmarks,
+            MemoryUsage,
+            ActionCount
+        };
+
+        enum Menu {
+            NoMenu = 0,
+            FileMenu,
+            ActionsMenu,
+            EditMenu,
+            ViewMenu,
+            MenuCount
+        };
+
+        struct Descriptor
+        {
+            ActionId id;
+            const char * name;      // settings key
+            const char * text;      // untranslated, "MainWindow" context
+            const char * icon;      // theme icon name or 0
+            const char * shortcut;  // default shortcut or 0
+            Menu menu;
+            bool separator;         // separator above the item
+            bool checkable;
+        };
+
+        static const Descriptor & descriptor(int id);
+
+        //! Translated text. Resolved once per process
+        static QString text(int id);
+        //! Theme icon. Resolved once per process
+        static QIcon icon(int id);
+        static QKeySequence defaultShortcut(int id);
+};
+
+#endif
@@ -0,0 +1,303 @@
+#include <QFile>
+#include <QTabBar>
+
+#include "activitymonitor.h"
+#include "termwidget.h"
+#include "termwidgetholder.h"
+#include "tabwidget.h"
+
+
+//! one tick for all terminals of all windows
+static const int SAMPLE_INTERVAL = 1000;
+
+ActivityMonitor * ActivityMonitor::m_instance = 0;
+
+
+//! The tab page \a term lives in, 0 for pooled terminals
+static TermWidgetHolder * holderOf(QWidget * term)
+{
+    for (QWidget * w = term->parentWidget(); w; w = w->parentWidget())
+    {
+        TermWidgetHolder * holder = qobject_cast<TermWidgetHolder*>(w);
+        if (holder)
+            return holder;
+    }
+    return 0;
+}
+
+static TabWidget * tabWidgetOf(TermWidgetHolder * holder)
+{
+    // the holder is in QTabWidget's QStackedWidget
+    for (QWidget * w = holder->parentWidget(); w; w = w->parentWidget())
+    {
+        TabWidget * tabs = qobject_cast<TabWidget*>(w);
+        if (tabs)
+            return tabs;
+    }
+    return 0;
+}
+
+/*! Is something else than the shell in the foreground of the terminal?
+    The shell puts each job into its own process group and gives it the
+    terminal.
+ */
+static bool isBusy(int shellPid)
+{
+#ifdef Q_OS_LINUX
+    if (shellPid <= 0)
+        return false;
+    QFile f(QString("/proc/%1/stat").arg(shellPid));
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    QByteArray stat = f.readAll();
+    // the command name may contain anything - the fields follow its ')'
+    int end = stat.lastIndexOf(')');
+    if (end == -1)
+        return false;
+    // state ppid pgrp session tty_nr tpgid ...
+    QList<QByteArray> fields = stat.mid(end + 2).split(' ');
+    if (fields.count() < 6)
+        return false;
+    int pgrp = fields.at(2).toInt();
+    int tpgid = fields.at(5).toInt();
+    return tpgid > 0 && tpgid != pgrp;
+#else
+    Q_UNUSED(shellPid);
+    return false;
+#endif
+}
+
+
+ActivityMonitor * ActivityMonitor::Instance()
+{
+    if (!m_instance)
+        m_instance = new ActivityMonitor();
+    return m_instance;
+}
+
+ActivityMonitor::ActivityMonitor()
+    : QObject(0)
+{
+    Properties * p = Properties::Instance();
+    m_activity = p->monitorActivity;
+    m_silence = p->monitorSilence;
+    m_finished = p->monitorFinished;
+
+    m_clock.start();
+    m_timer.setInterval(SAMPLE_INTERVAL);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(sample()));
+    connect(p, SIGNAL(changed(Properties::Changes)),
+            this, SLOT(propertiesChanged(Properties::Changes)));
+}
+
+bool ActivityMonitor::isEnabled() const
+{
+    Properties * p = Properties::Instance();
+    return p->monitorActivity || p->monitorSilence > 0 || p->monitorFinished;
+}
+
+QIcon ActivityMonitor::icon(State state)
+{
+    switch (state)
+    {
+    case Activity:
+        return QIcon::fromTheme("dialog-information");
+    case Silence:
+        return QIcon::fromTheme("media-playback-pause");
+    case Finished:
+        return QIcon::fromTheme("process-stop");
+    default:
+        return QIcon();
+    }
+}
+
+void ActivityMonitor::addTerminal(TermWidgetImpl * term)
+{
+    Entry e;
+    e.count = term->outputCount();
+    e.lastOutput = m_clock.elapsed();
+    m_terminals[term] = e;
+    updateTimer();
+}
+
+void ActivityMonitor::removeTerminal(TermWidgetImpl * term)
+{
+    // the tab is updated with the next change of its other terminals
+    m_terminals.remove(term);
+    updateTimer();
+}
+
+void ActivityMonitor::updateTimer()
+{
+    if (isEnabled() && !m_terminals.isEmpty())
+    {
+        if (!m_timer.isActive())
+            m_timer.start();
+    }
+    else
+        m_timer.stop();
+}
+
+void ActivityMonitor::propertiesChanged(Properties::Changes changes)
+{
+    if (!(changes & Properties::WindowOptions))
+        return;
+
+    Properties * p = Properties::Instance();
+    if (p->monitorActivity == m_activity && p->monitorSilence == m_silence
+        && p->monitorFinished == m_finished)
+        return;
+    m_activity = p->monitorActivity;
+    m_silence = p->monitorSilence;
+    m_finished = p->monitorFinished;
+
+    // start over with the new settings
+    QList<TermWidgetHolder*> holders;
+    QHash<TermWidgetImpl*, Entry>::iterator it = m_terminals.begin();
+    while (it != m_terminals.end())
+    {
+        it.value().active = false;
+        it.value().busy = false;
+        if (it.value().state != None)
+        {
+            it.value().state = None;
+            TermWidgetHolder * holder = holderOf(it.key());
+            if (holder && !holders.contains(holder))
+                holders.append(holder);
+        }
+        ++it;
+    }
+    updateTabs(holders);
+    updateTimer();
+}
+
+void ActivityMonitor::tabShown(int index)
+{
+    TabWidget * tabs = qobject_cast<TabWidget*>(sender());
+    if (!tabs)
+        return;
+    TermWidgetHolder * holder = qobject_cast<TermWidgetHolder*>(tabs->widget(index));
+    if (!holder)
+        return;
+
+    foreach (TermWidget * term, holder->terminals())
+    {
+        QHash<TermWidgetImpl*, Entry>::iterator it = m_terminals.find(term->impl());
+        if (it == m_terminals.end())
+            continue;
+        it.value().active = false;
+        it.value().busy = false;
+        it.value().state = None;
+    }
+    if (m_tabs.remove(holder))
+        tabs->setTabIcon(index, QIcon());
+}
+
+void ActivityMonitor::holderDestroyed(QObject * obj)
+{
+    // only the key is needed - the holder is gone already
+    m_tabs.remove(static_cast<TermWidgetHolder*>(obj));
+}
+
+void ActivityMonitor::sample()
+{
+    Properties * p = Properties::Instance();
+    qint64 now = m_clock.elapsed();
+    QList<TermWidgetHolder*> changed;
+
+    QHash<TermWidgetImpl*, Entry>::iterator it = m_terminals.begin();
+    while (it != m_terminals.end())
+    {
+        TermWidgetImpl * term = it.key();
+        Entry & e = it.value();
+        ++it;
+
+        quint32 count = term->outputCount();
+        bool output = count != e.count;
+        e.count = count;
+        if (output)
+            e.lastOutput = now;
+
+        // the user sees it - nothing to tell
+        if (term->isVisible())
+        {
+            e.active = false;
+            e.busy = false;
+            e.state = None;
+            continue;
+        }
+
+        State state = e.state;
+        if (output)
+        {
+            e.active = true;
+            if (p->monitorActivity && state != Finished)
+                state = Activity;
+        }
+        else if (e.active && p->monitorSilence > 0
+                 && now - e.lastOutput >= p->monitorSilence * 1000)
+        {
+            // once per burst of output
+            e.active = false;
+            if (state != Finished)
+                state = Silence;
+        }
+
+        if (p->monitorFinished)
+        {
+            bool busy = isBusy(term->getShellPID());
+            if (e.busy && !busy)
+                state = Finished;
+            e.busy = busy;
+        }
+
+        if (state == e.state)
+            continue;
+        e.state = state;
+        TermWidgetHolder * holder = holderOf(term);
+        if (holder && !changed.contains(holder))
+            changed.append(holder);
+    }
+
+    updateTabs(changed);
+}
+
+void ActivityMonitor::updateTabs(const QList<TermWidgetHolder*> & holders)
+{
+    // holders whose tab icon changes, per tab bar
+    QHash<TabWidget*, QList<TermWidgetHolder*> > dirty;
+    foreach (TermWidgetHolder * holder, holders)
+    {
+        State state = None;
+        foreach (TermWidget * term, holder->terminals())
+            state = qMax(state, m_terminals.value(term->impl()).state);
+
+        if (m_tabs.value(holder, None) == state)
+            continue;
+        if (state == None)
+            m_tabs.remove(holder);
+        else
+        {
+            m_tabs[holder] = state;
+            connect(holder, SIGNAL(destroyed(QObject*)), this, SLOT(holderDestroyed(QObject*)),
+                    Qt::UniqueConnection);
+        }
+        TabWidget * tabs = tabWidgetOf(holder);
+        if (tabs)
+            dirty[tabs].append(holder);
+    }
+
+    QHash<TabWidget*, QList<TermWidgetHolder*> >::const_iterator it = dirty.constBegin();
+    while (it != dirty.constEnd())
+    {
+        TabWidget * tabs = it.key();
+        // one repaint of the tab bar for all its tabs
+        tabs->tabBar()->setUpdatesEnabled(false);
+        foreach (TermWidgetHolder * holder, it.value())
+        {
+            tabs->setTabIcon(tabs->indexOf(holder), icon(m_tabs.value(holder, None)));
+        }
+        tabs->tabBar()->setUpdatesEnabled(true);
+        ++it;
+    }
+}
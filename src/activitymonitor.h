@@ -0,0 +1,92 @@
+#ifndef ACTIVITYMONITOR_H
+#define ACTIVITYMONITOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QIcon>
+
+#include "properties.h"
+
+class TermWidgetImpl;
+class TermWidgetHolder;
+class TabWidget;
+
+
+/*! \brief Tab indicators for new output, silence and finished commands.
+
+Terminals only bump a counter when they receive output (see
+TermWidgetImpl::outputCount()). One timer shared by all windows samples
+the counters of the terminals which are not visible, so the cost per
+received chunk doesn't depend on the number of tabs and nothing runs
+per byte. Tabs whose indicator has changed get their icons set in one
+go - one repaint of each QTabBar per tick.
+
+A command has finished when the terminal's foreground process group
+goes back to the shell (Linux only). The indicators of a tab are
+cleared when it becomes current.
+*/
+class ActivityMonitor : public QObject
+{
+    Q_OBJECT
+
+    public:
+        //! ordered by importance - a tab shows the highest of its terminals
+        enum State {
+            None = 0,
+            Activity,
+            Silence,
+            Finished
+        };
+
+        static ActivityMonitor * Instance();
+
+        bool isEnabled() const;
+
+        void addTerminal(TermWidgetImpl * term);
+        void removeTerminal(TermWidgetImpl * term);
+
+        static QIcon icon(State state);
+
+    public slots:
+        void propertiesChanged(Properties::Changes changes = Properties::AllChanges);
+        //! TabWidget::currentChanged() - the tab has been seen
+        void tabShown(int index);
+
+    private:
+        ActivityMonitor();
+
+        static ActivityMonitor * m_instance;
+
+        struct Entry {
+            Entry() : count(0), lastOutput(0), active(false), busy(false), state(None) {}
+            //! TermWidgetImpl::outputCount() at the last tick
+            quint32 count;
+            qint64 lastOutput;
+            //! output since the terminal has been hidden
+            bool active;
+            //! a command was running at the last tick
+            bool busy;
+            State state;
+        };
+        QHash<TermWidgetImpl*, Entry> m_terminals;
+        //! the state shown by the tab of each holder, None is not stored
+        QHash<TermWidgetHolder*, State> m_tabs;
+        QTimer m_timer;
+        QElapsedTimer m_clock;
+
+        //! the settings the indicators have been computed with
+        bool m_activity;
+        int m_silence;
+        bool m_finished;
+
+        void updateTimer();
+        void updateTabs(const QList<TermWidgetHolder*> & holders);
+
+    private slots:
+        void sample();
+        void holderDestroyed(QObject * obj);
+};
+
+#endif
@@ -5,10 +5,12 @@
 #endif
 
 #include <QDebug>
+#include <QThread>
 
 #include "bookmarkswidget.h"
 #include "properties.h"
 #include "config.h"
+#include "startuptrace.h"
 
 
 class AbstractBookmarkItem
@@ -257,26 +259,96 @@ public:
 };
 
 
+/*! Builds the complete item tree out of the GUI thread.
+    BookmarkLocalGroupItem stats every env variable value and
+    BookmarkFileGroupItem parses the whole XML file - both can be really
+    slow eg. on NFS homes.
+ */
+class BookmarksLoader : public QThread
+{
+public:
+    BookmarksLoader(const QString &fname)
+        : QThread(0),
+          m_fname(fname),
+          m_root(0)
+    {
+    }
+    ~BookmarksLoader()
+    {
+        if (m_root)
+            delete m_root;
+    }
+
+    AbstractBookmarkItem *takeRoot()
+    {
+        AbstractBookmarkItem *root = m_root;
+        m_root = 0;
+        return root;
+    }
+
+protected:
+    void run()
+    {
+        TraceSpan trace("BookmarksModel::setup");
+        m_root = new BookmarkRootItem();
+        m_root->addChild(new BookmarkLocalGroupItem(m_root));
+        m_root->addChild(new BookmarkFileGroupItem(m_root, m_fname));
+    }
+
+private:
+    QString m_fname;
+    AbstractBookmarkItem *m_root;
+};
+
+
 BookmarksModel::BookmarksModel(QObject *parent)
     : QAbstractItemModel(parent),
-      m_root(0)
+      m_root(new BookmarkRootItem()),
+      m_loader(0),
+      m_reloadPending(false)
 {
-    setup();
 }
 
 void BookmarksModel::setup()
 {
+    if (m_loader)
+    {
+        // the file may have been changed meanwhile - load it again later
+        m_reloadPending = true;
+        return;
+    }
+
+    m_loader = new BookmarksLoader(Properties::Instance()->bookmarksFile);
+    connect(m_loader, SIGNAL(finished()), this, SLOT(loaderFinished()));
+    m_loader->start(QThread::LowPriority);
+}
+
+void BookmarksModel::loaderFinished()
+{
+    beginResetModel();
     if (m_root)
         delete m_root;
-    m_root = new BookmarkRootItem();
-    m_root->addChild(new BookmarkLocalGroupItem(m_root));
-    m_root->addChild(new BookmarkFileGroupItem(m_root, Properties::Instance()->bookmarksFile));
-    beginResetModel();
+    m_root = m_loader->takeRoot();
     endResetModel();
+
+    m_loader->deleteLater();
+    m_loader = 0;
+
+    if (m_reloadPending)
+    {
+        m_reloadPending = false;
+        setup();
+    }
 }
 
 BookmarksModel::~BookmarksModel()
 {
+    if (m_loader)
+    {
+        // do not block on the running thread. It cleans up after itself.
+        disconnect(m_loader, 0, this, 0);
+        connect(m_loader, SIGNAL(finished()), m_loader, SLOT(deleteLater()));
+    }
     if (m_root)
         delete m_root;
 }
@@ -391,6 +463,8 @@ BookmarksWidget::BookmarksWidget(QWidget *parent)
 
     connect(treeView, SIGNAL(doubleClicked(QModelIndex)),
             this, SLOT(handleCommand(QModelIndex)));
+    connect(m_model, SIGNAL(modelReset()),
+            this, SLOT(expandTree()));
 }
 
 BookmarksWidget::~BookmarksWidget()
@@ -400,7 +474,10 @@ BookmarksWidget::~BookmarksWidget()
 void BookmarksWidget::setup()
 {
     m_model->setup();
+}
 
+void BookmarksWidget::expandTree()
+{
     treeView->expandAll();
     treeView->resizeColumnToContents(0);
     treeView->resizeColumnToContents(1);
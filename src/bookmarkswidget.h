@@ -5,6 +5,7 @@
 
 class AbstractBookmarkItem;
 class BookmarksModel;
+class BookmarksLoader;
 
 
 class BookmarksWidget : public QWidget, Ui::BookmarksWidget
@@ -25,6 +26,7 @@ private:
 
 private slots:
     void handleCommand(const QModelIndex& index);
+    void expandTree();
 };
 
 
@@ -36,6 +38,9 @@ public:
     BookmarksModel(QObject *parent = 0);
     ~BookmarksModel();
 
+    /*! (Re)build the bookmarks tree. It's done in a BookmarksLoader
+        thread and the model is reset once the tree is complete.
+     */
     void setup();
 
     QVariant data(const QModelIndex &index, int role) const;
@@ -52,6 +57,11 @@ public:
 private:
     AbstractBookmarkItem *getItem(const QModelIndex &index) const;
     AbstractBookmarkItem *m_root;
+    BookmarksLoader *m_loader;
+    bool m_reloadPending;
+
+private slots:
+    void loaderFinished();
 };
 
 #endif
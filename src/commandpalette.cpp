@@ -0,0 +1,213 @@
+#include <QApplication>
+#include <QKeyEvent>
+#include <algorithm>
+
+#include "commandpalette.h"
+#include "paletteindex.h"
+#include "actionregistry.h"
+#include "mainwindow.h"
+#include "tabwidget.h"
+#include "termwidget.h"
+#include "termwidgetholder.h"
+
+
+//! index into PaletteIndex::entries()
+static const int EntryRole = Qt::UserRole + 1;
+//! entries ranked between two updates of the results
+static const int SLICE_SIZE = 20000;
+//! nobody scrolls further - type more
+static const int MAX_SHOWN = 100;
+
+
+static QIcon entryIcon(const PaletteEntry &e)
+{
+    static QIcon paneIcon = QIcon::fromTheme("utilities-terminal");
+    static QIcon bookmarkIcon = QIcon::fromTheme("bookmarks");
+
+    switch (e.kind)
+    {
+    case PaletteEntry::Action:
+        return ActionRegistry::icon(e.id);
+    case PaletteEntry::Pane:
+        return paneIcon;
+    default:
+        return bookmarkIcon;
+    }
+}
+
+
+CommandPalette::CommandPalette(MainWindow *parent)
+    : QDialog(parent),
+      m_window(parent),
+      m_generation(-1),
+      m_all(true),
+      m_pos(0)
+{
+    setupUi(this);
+
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(0);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(rankSlice()));
+
+    PaletteIndex *index = PaletteIndex::Instance();
+    index->refreshPanes();
+    // eg. the bookmarks have been loaded meanwhile
+    connect(index, SIGNAL(changed()), this, SLOT(search()));
+
+    connect(queryEdit, SIGNAL(textChanged(QString)), this, SLOT(search()));
+    connect(queryEdit, SIGNAL(returnPressed()), this, SLOT(activate()));
+    connect(resultsTree, SIGNAL(itemActivated(QTreeWidgetItem*,int)),
+            this, SLOT(activate()));
+    queryEdit->installEventFilter(this);
+    queryEdit->setFocus();
+
+    search();
+}
+
+bool CommandPalette::betterMatch(const Match &a, const Match &b)
+{
+    if (a.score != b.score)
+        return a.score > b.score;
+    return a.entry < b.entry;
+}
+
+void CommandPalette::search()
+{
+    QString query = queryEdit->text().toLower();
+    PaletteIndex *index = PaletteIndex::Instance();
+
+    // everything matching "abc" matches "ab" too
+    if (m_generation == index->generation() && !m_timer.isActive() && query.startsWith(m_query))
+    {
+        m_candidates.resize(m_matches.count());
+        for (int i = 0; i < m_matches.count(); ++i)
+            m_candidates[i] = m_matches.at(i).entry;
+        m_all = false;
+    }
+    else
+    {
+        m_candidates.clear();
+        m_all = true;
+    }
+
+    m_timer.stop();
+    m_query = query;
+    m_generation = index->generation();
+    m_matches.clear();
+    m_pos = 0;
+    rankSlice();
+}
+
+void CommandPalette::rankSlice()
+{
+    const QVector<PaletteEntry> &entries = PaletteIndex::Instance()->entries();
+    int count = m_all ? entries.count() : m_candidates.count();
+    int end = qMin(m_pos + SLICE_SIZE, count);
+
+    for (; m_pos < end; ++m_pos)
+    {
+        int entry = m_all ? m_pos : m_candidates.at(m_pos);
+        int score = PaletteIndex::score(entries.at(entry).key, m_query);
+        if (score >= 0)
+        {
+            Match m = { score, entry };
+            m_matches.append(m);
+        }
+    }
+
+    showMatches();
+    if (m_pos < count)
+    {
+        statusLabel->setText(tr("Searching... %n match(es)", "", m_matches.count()));
+        m_timer.start();
+    }
+    else
+        statusLabel->setText(tr("%n match(es)", "", m_matches.count()));
+}
+
+void CommandPalette::showMatches()
+{
+    const QVector<PaletteEntry> &entries = PaletteIndex::Instance()->entries();
+    int shown = qMin(m_matches.count(), MAX_SHOWN);
+    // only the shown ones are sorted
+    std::partial_sort(m_matches.begin(), m_matches.begin() + shown, m_matches.end(), betterMatch);
+
+    resultsTree->setUpdatesEnabled(false);
+    resultsTree->clear();
+    for (int i = 0; i < shown; ++i)
+    {
+        const PaletteEntry &e = entries.at(m_matches.at(i).entry);
+        QTreeWidgetItem *item = new QTreeWidgetItem(resultsTree);
+        item->setIcon(0, entryIcon(e));
+        item->setText(0, e.text);
+        item->setText(1, e.detail);
+        item->setData(0, EntryRole, m_matches.at(i).entry);
+    }
+    if (shown > 0)
+        resultsTree->setCurrentItem(resultsTree->topLevelItem(0));
+    resultsTree->setUpdatesEnabled(true);
+}
+
+void CommandPalette::activate()
+{
+    QTreeWidgetItem *item = resultsTree->currentItem();
+    PaletteIndex *index = PaletteIndex::Instance();
+    if (!item || m_generation != index->generation())
+        return;
+    int i = item->data(0, EntryRole).toInt();
+    if (i < 0 || i >= index->entries().count())
+        return;
+    PaletteEntry e = index->entries().at(i);
+
+    // first - the action may open another dialog or move the focus
+    close();
+
+    switch (e.kind)
+    {
+    case PaletteEntry::Action:
+    {
+        QAction *act = m_window->action(e.id);
+        if (act && act->isEnabled() && act->isVisible())
+            act->trigger();
+        break;
+    }
+    case PaletteEntry::Pane:
+    {
+        if (!e.window)
+            return;
+        e.window->show();
+        e.window->raise();
+        e.window->activateWindow();
+        TabWidget *tabs = e.window->findChild<TabWidget*>("consoleTabulator");
+        TermWidgetHolder *holder = tabs ? tabs->holder(e.id) : 0;
+        if (!holder)
+            return;
+        tabs->setCurrentIndex(tabs->indexOf(holder));
+        if (e.term)
+            e.term->setFocus();
+        break;
+    }
+    case PaletteEntry::Bookmark:
+        emit callCommand(e.detail + "\n");
+        break;
+    }
+}
+
+bool CommandPalette::eventFilter(QObject *obj, QEvent *event)
+{
+    if (obj == queryEdit && event->type() == QEvent::KeyPress)
+    {
+        switch (static_cast<QKeyEvent*>(event)->key())
+        {
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            QApplication::sendEvent(resultsTree, event);
+            return true;
+        default:
+            break;
+        }
+    }
+    return QDialog::eventFilter(obj, event);
+}
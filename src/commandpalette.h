@@ -0,0 +1,60 @@
+#ifndef COMMANDPALETTE_H
+#define COMMANDPALETTE_H
+
+#include <QTimer>
+#include <QVector>
+
+#include "ui_commandpalette.h"
+
+class MainWindow;
+
+
+/*! \brief "Command Palette" - go to anything by typing a part of its name.
+
+Ranks the PaletteIndex entries by PaletteIndex::score() in slices so the
+first results are shown while the rest is ranked. A query which extends
+the previous one only ranks the previous matches again. Actions run in
+the window the palette belongs to, bookmarks are sent to its current
+terminal.
+*/
+class CommandPalette : public QDialog, public Ui::CommandPalette
+{
+    Q_OBJECT
+public:
+    CommandPalette(MainWindow *parent);
+
+signals:
+    void callCommand(const QString &cmd);
+
+protected:
+    //! Up/Down and Page Up/Down in the query edit move in the results
+    bool eventFilter(QObject *obj, QEvent *event);
+
+private:
+    struct Match
+    {
+        int score;
+        int entry;
+    };
+
+    MainWindow *m_window;
+    QTimer m_timer;
+    //! the query being ranked and PaletteIndex::generation() of its matches
+    QString m_query;
+    int m_generation;
+    //! entries to rank, all of them when m_all is set
+    QVector<int> m_candidates;
+    bool m_all;
+    int m_pos;
+    QVector<Match> m_matches;
+
+    static bool betterMatch(const Match &a, const Match &b);
+    void showMatches();
+
+private slots:
+    void search();
+    void rankSlice();
+    void activate();
+};
+
+#endif
@@ -28,6 +28,8 @@
 #define NEW_WINDOW "New Window"
 
 #define QUIT "Quit"
+#define SAVE_SESSION "Save Session"
+#define LOAD_SESSION "Load Session"
 #define PREFERENCES "Preferences..."
 
 #define TAB_NEXT "Next Tab"
@@ -41,6 +43,11 @@
 #define SUB_COLLAPSE "Collapse Subterminal"
 #define SUB_NEXT "Next Subterminal"
 #define SUB_PREV "Previous Subterminal"
+#define SUB_LEFT "Left Subterminal"
+#define SUB_RIGHT "Right Subterminal"
+#define SUB_UP "Upper Subterminal"
+#define SUB_DOWN "Lower Subterminal"
+#define SYNCHRONIZE_INPUT "Synchronize Input"
 
 #define MOVE_LEFT "Move Tab Left"
 #define MOVE_RIGHT "Move Tab Right"
@@ -54,12 +61,15 @@
 #define ZOOM_RESET "Zoom reset"
 
 #define FIND "Find"
+#define FIND_ALL "Find in All Tabs"
+#define COMMAND_PALETTE "Command Palette"
 
 #define TOGGLE_MENU "Toggle Menu"
 #define TOGGLE_BOOKMARKS "Toggle Bookmarks"
 
 #define HIDE_WINDOW_BORDERS "Hide Window Borders"
 #define SHOW_TAB_BAR "Show Tab Bar"
+#define MEMORY_USAGE "Memory Usage"
 
 /* Some defaults for QTerminal application */
 
@@ -96,6 +106,9 @@
 #define TOGGLE_BOOKMARKS_SHORTCUT       "Ctrl+Shift+B"
 #endif
 
+#define FIND_ALL_SHORTCUT              "Ctrl+Shift+Alt+F"
+#define COMMAND_PALETTE_SHORTCUT       "Ctrl+Shift+P"
+
 #define ZOOM_IN_SHORTCUT               "Ctrl++"
 #define ZOOM_OUT_SHORTCUT              "Ctrl+-"
 #define ZOOM_RESET_SHORTCUT              "Ctrl+0"
@@ -0,0 +1,51 @@
+#include <QFontMetrics>
+#include <QPaintDevice>
+
+#include "fontcache.h"
+
+
+//! fonts and zoom steps in use at once - a few per screen
+static const int MAX_FONTS = 16;
+//! what the display measures its character cell with
+static const char * const CELL_CHARS = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789./+@";
+
+FontCache * FontCache::m_instance = 0;
+
+
+FontCache * FontCache::Instance()
+{
+    if (!m_instance)
+        m_instance = new FontCache();
+    return m_instance;
+}
+
+FontCache::FontCache()
+    : m_fonts(MAX_FONTS)
+{
+}
+
+QFont FontCache::font(const QFont & font, QPaintDevice * device)
+{
+    int dpi = device ? device->logicalDpiY() : 0;
+    QString key = QString("%1@%2").arg(font.key()).arg(dpi);
+    QFont * cached = m_fonts.object(key);
+    if (cached)
+        return *cached;
+
+    cached = new QFont(font);
+    // TerminalDisplay::setVTFont() changes these - with them already set
+    // the display keeps the shared copy instead of detaching its own
+    cached->setStyleStrategy(QFont::ForceIntegerMetrics);
+    cached->setKerning(false);
+
+    // load the font engine and its metrics now, not with the first paint
+    QFontMetrics metrics(*cached, device);
+#if QT_VERSION >= QT_VERSION_CHECK(5,11,0)
+    metrics.horizontalAdvance(QLatin1String(CELL_CHARS));
+#else
+    metrics.width(QLatin1String(CELL_CHARS));
+#endif
+
+    m_fonts.insert(key, cached);
+    return *cached;
+}
@@ -0,0 +1,35 @@
+#ifndef FONTCACHE_H
+#define FONTCACHE_H
+
+#include <QCache>
+#include <QFont>
+
+class QPaintDevice;
+
+
+/*! \brief Terminal fonts shared by all terminals of all windows.
+
+Qt keeps the rasterized glyphs in its font engines - one per font, size
+and DPI for the whole process - but it drops an engine nobody uses any
+more, and every QFont which is changed after it has been copied gets a
+private copy with its own metrics. Here each font (and zoom step) is
+set up once per DPI the way the terminal display uses it, its engine is
+loaded and kept, and every terminal gets the same shared QFont.
+*/
+class FontCache
+{
+    public:
+        static FontCache * Instance();
+
+        //! Shared copy of \a font set up for terminals on \a device
+        QFont font(const QFont & font, QPaintDevice * device);
+
+    private:
+        FontCache();
+        static FontCache * m_instance;
+
+        //! by QFont::key() and DPI, the least recently used ones go first
+        QCache<QString, QFont> m_fonts;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include <QCoreApplication>
+#include <QRunnable>
+#include <QEvent>
+
+#include "globalsearch.h"
+#include "scrollbackarchive.h"
+#include "mainwindow.h"
+#include "tabwidget.h"
+#include "termwidgetholder.h"
+#include "termwidget.h"
+
+
+//! a line like "error" can be everywhere
+static const int MAX_HITS_PER_TERMINAL = 1000;
+
+static const QEvent::Type SearchResultType = (QEvent::Type)QEvent::registerEventType();
+
+
+//! Matches of one terminal, posted from a pool thread
+class SearchResultEvent : public QEvent
+{
+public:
+    SearchResultEvent(int generation, int target, const QList<ScrollbackArchive::Match> & matches)
+        : QEvent(SearchResultType),
+          generation(generation),
+          target(target),
+          matches(matches)
+    {
+    }
+
+    int generation;
+    int target;
+    QList<ScrollbackArchive::Match> matches;
+};
+
+
+/*! Searches one snapshot. Only plain values cross the thread
+    boundary; the terminal is identified by its index (target).
+ */
+class SearchJob : public QRunnable
+{
+public:
+    SearchJob(GlobalSearch * receiver, int generation, int target,
+              const ScrollbackArchive::Snapshot & snapshot,
+              const QString & text, QAtomicInt * cancel)
+        : m_receiver(receiver),
+          m_generation(generation),
+          m_target(target),
+          m_snapshot(snapshot),
+          m_text(text),
+          m_cancel(cancel)
+    {
+    }
+
+    void run()
+    {
+        QList<ScrollbackArchive::Match> matches =
+                ScrollbackArchive::search(m_snapshot, m_text, MAX_HITS_PER_TERMINAL, m_cancel);
+        // the receiver waits for the pool before it is deleted
+        QCoreApplication::postEvent(m_receiver, new SearchResultEvent(m_generation, m_target, matches));
+    }
+
+private:
+    GlobalSearch * m_receiver;
+    int m_generation;
+    int m_target;
+    ScrollbackArchive::Snapshot m_snapshot;
+    QString m_text;
+    QAtomicInt * m_cancel;
+};
+
+
+GlobalSearch::GlobalSearch(QObject * parent)
+    : QObject(parent),
+      m_cancel(0),
+      m_generation(0),
+      m_pending(0)
+{
+}
+
+GlobalSearch::~GlobalSearch()
+{
+    cancel();
+}
+
+void GlobalSearch::cancel()
+{
+    // the jobs check it between chunks so this is short
+    m_cancel.fetchAndStoreOrdered(1);
+    m_pool.waitForDone();
+    m_pending = 0;
+}
+
+void GlobalSearch::start(const QString & text)
+{
+    cancel();
+    m_cancel.fetchAndStoreOrdered(0);
+    ++m_generation;
+    m_targets.clear();
+    m_hits.clear();
+
+    foreach (MainWindow * w, MainWindow::windows())
+    {
+        TabWidget * tabs = w->findChild<TabWidget*>("consoleTabulator");
+        if (!tabs)
+            continue;
+
+        for (int i = 0; i < tabs->count(); ++i)
+        {
+            TermWidgetHolder * holder = qobject_cast<TermWidgetHolder*>(tabs->widget(i));
+            if (!holder)
+                continue;
+
+            // deferred tabs have no terminals yet
+            QList<TermWidget*> terms = holder->terminals();
+            for (int pane = 0; pane < terms.count(); ++pane)
+            {
+                ScrollbackArchive * archive = terms.at(pane)->impl()->archive();
+                if (!archive)
+                    continue;
+
+                SearchHit target;
+                target.term = terms.at(pane);
+                target.window = w;
+                target.holderId = holder->id();
+                target.tabLabel = tabs->tabText(i);
+                target.pane = pane + 1;
+                target.line = -1;
+                target.droppedLines = archive->droppedLines();
+                m_targets.append(target);
+
+                m_pool.start(new SearchJob(this, m_generation, m_targets.count() - 1,
+                                           archive->snapshot(), text, &m_cancel));
+                ++m_pending;
+            }
+        }
+    }
+
+    if (!m_pending)
+        emit finished();
+}
+
+void GlobalSearch::customEvent(QEvent * event)
+{
+    if (event->type() != SearchResultType)
+    {
+        QObject::customEvent(event);
+        return;
+    }
+
+    SearchResultEvent * e = static_cast<SearchResultEvent*>(event);
+    // cancelled search
+    if (e->generation != m_generation || m_pending == 0)
+        return;
+
+    int first = m_hits.count();
+    foreach (const ScrollbackArchive::Match & m, e->matches)
+    {
+        SearchHit hit = m_targets.at(e->target);
+        hit.line = m.line;
+        hit.text = m.text;
+        m_hits.append(hit);
+    }
+    if (m_hits.count() > first)
+        emit hitsAdded(first);
+
+    if (--m_pending == 0)
+        emit finished();
+}
@@ -0,0 +1,76 @@
+#ifndef GLOBALSEARCH_H
+#define GLOBALSEARCH_H
+
+#include <QObject>
+#include <QPointer>
+#include <QList>
+#include <QAtomicInt>
+#include <QThreadPool>
+
+class TermWidget;
+class MainWindow;
+
+
+//! One matching line
+struct SearchHit
+{
+    QPointer<TermWidget> term;
+    QPointer<MainWindow> window;
+    //! TermWidgetHolder::id() - the tab may have been moved meanwhile
+    int holderId;
+    QString tabLabel;
+    //! 1-based position of the terminal in its tab
+    int pane;
+    //! line number in the terminal's ScrollbackArchive
+    qint64 line;
+    //! ScrollbackArchive::droppedLines() when it was found
+    qint64 droppedLines;
+    QString text;
+};
+
+
+/*! \brief Case insensitive search in the history of all terminals.
+
+start() takes a snapshot of every terminal's ScrollbackArchive in the
+GUI thread and searches them in parallel on a private thread pool.
+The archives' trigram filters keep repeated searches from reading the
+chunks which cannot match. Results arrive per terminal (hitsAdded());
+a new start() or the destructor cancels the running search.
+*/
+class GlobalSearch : public QObject
+{
+    Q_OBJECT
+
+    public:
+        GlobalSearch(QObject * parent = 0);
+        ~GlobalSearch();
+
+        void start(const QString & text);
+        void cancel();
+        bool isRunning() const { return m_pending > 0; }
+
+        const QList<SearchHit> & hits() const { return m_hits; }
+        //! Terminals with a ScrollbackArchive in the last start()
+        int searchedCount() const { return m_targets.count(); }
+
+    signals:
+        //! hits() from \a first on are new
+        void hitsAdded(int first);
+        void finished();
+
+    protected:
+        void customEvent(QEvent * event);
+
+    private:
+        QThreadPool m_pool;
+        QAtomicInt m_cancel;
+        //! results of older searches are ignored
+        int m_generation;
+        //! terminals not searched yet
+        int m_pending;
+        //! terminal of each job, SearchHit::line is not used
+        QList<SearchHit> m_targets;
+        QList<SearchHit> m_hits;
+};
+
+#endif
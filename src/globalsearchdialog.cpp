@@ -0,0 +1,138 @@
+#include <QScrollBar>
+
+#include "globalsearchdialog.h"
+#include "globalsearch.h"
+#include "historydialog.h"
+#include "scrollbackarchive.h"
+#include "mainwindow.h"
+#include "tabwidget.h"
+#include "termwidgetholder.h"
+#include "termwidget.h"
+
+
+enum Columns {
+    WindowColumn = 0,
+    TabColumn,
+    PaneColumn,
+    LineColumn,
+    TextColumn
+};
+
+//! index into GlobalSearch::hits()
+static const int HitRole = Qt::UserRole + 1;
+//! more is not readable anyway
+static const int MAX_SHOWN_HITS = 5000;
+
+
+GlobalSearchDialog::GlobalSearchDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setupUi(this);
+
+    m_search = new GlobalSearch(this);
+    connect(m_search, SIGNAL(hitsAdded(int)), this, SLOT(addHits(int)));
+    connect(m_search, SIGNAL(finished()), this, SLOT(searchFinished()));
+
+    connect(queryEdit, SIGNAL(returnPressed()), this, SLOT(search()));
+    connect(searchButton, SIGNAL(clicked()), this, SLOT(search()));
+    connect(resultsTree, SIGNAL(itemActivated(QTreeWidgetItem*,int)),
+            this, SLOT(activateHit(QTreeWidgetItem*)));
+
+    queryEdit->setFocus();
+}
+
+void GlobalSearchDialog::search()
+{
+    m_query = queryEdit->text();
+    resultsTree->clear();
+    if (m_query.isEmpty())
+        return;
+
+    statusLabel->setText(tr("Searching..."));
+    m_search->start(m_query);
+}
+
+void GlobalSearchDialog::addHits(int first)
+{
+    const QList<SearchHit> & hits = m_search->hits();
+    for (int i = first; i < hits.count() && resultsTree->topLevelItemCount() < MAX_SHOWN_HITS; ++i)
+    {
+        const SearchHit & hit = hits.at(i);
+        QTreeWidgetItem *item = new QTreeWidgetItem(resultsTree);
+        item->setText(WindowColumn, hit.window ? hit.window->windowTitle() : QString());
+        item->setText(TabColumn, hit.tabLabel);
+        item->setText(PaneColumn, QString::number(hit.pane));
+        item->setText(LineColumn, QString::number(hit.line + 1));
+        item->setText(TextColumn, hit.text.trimmed());
+        item->setData(WindowColumn, HitRole, i);
+    }
+    statusLabel->setText(tr("Searching... %n line(s) found", "", hits.count()));
+}
+
+void GlobalSearchDialog::searchFinished()
+{
+    for (int i = 0; i < TextColumn; ++i)
+        resultsTree->resizeColumnToContents(i);
+
+    int count = m_search->hits().count();
+    // the archive is off by default
+    if (m_search->searchedCount() == 0)
+        statusLabel->setText(tr("No terminal keeps a searchable history. Enable \"Keep a searchable "
+                                "copy of the history\" in Preferences - only output received "
+                                "after that can be found."));
+    else if (count == 0)
+        statusLabel->setText(tr("0 line(s) found - only output received since the searchable "
+                                "copy of the history has been enabled is searched"));
+    else if (count > resultsTree->topLevelItemCount())
+        statusLabel->setText(tr("%n line(s) found, the first %1 are shown", "", count)
+                             .arg(resultsTree->topLevelItemCount()));
+    else
+        statusLabel->setText(tr("%n line(s) found", "", count));
+}
+
+void GlobalSearchDialog::activateHit(QTreeWidgetItem *item)
+{
+    int i = item->data(WindowColumn, HitRole).toInt();
+    if (i < 0 || i >= m_search->hits().count())
+        return;
+    SearchHit hit = m_search->hits().at(i);
+    if (!hit.term || !hit.window)
+    {
+        statusLabel->setText(tr("The terminal has been closed"));
+        return;
+    }
+
+    hit.window->show();
+    hit.window->raise();
+    hit.window->activateWindow();
+    TabWidget *tabs = hit.window->findChild<TabWidget*>("consoleTabulator");
+    TermWidgetHolder *holder = tabs ? tabs->holder(hit.holderId) : 0;
+    if (holder)
+        tabs->setCurrentIndex(tabs->indexOf(holder));
+    hit.term->setFocus();
+
+    TermWidgetImpl *impl = hit.term->impl();
+    ScrollbackArchive *archive = impl->archive();
+    if (!archive)
+        return;
+    // line numbers shift when the oldest lines are dropped
+    qint64 line = hit.line - (archive->droppedLines() - hit.droppedLines);
+    if (line < 0 || line >= archive->lineCount())
+    {
+        statusLabel->setText(tr("The line is no longer in the history"));
+        return;
+    }
+
+    // the history and the screen of the terminal itself
+    QScrollBar *scrollBar = impl->findChild<QScrollBar*>();
+    qint64 shown = scrollBar ? scrollBar->maximum() + scrollBar->pageStep() : 0;
+    if (archive->lineCount() - line <= shown)
+    {
+        impl->showSearch(m_query);
+        return;
+    }
+
+    HistoryDialog *dlg = new HistoryDialog(impl);
+    dlg->show();
+    dlg->showLine(line, m_query);
+}
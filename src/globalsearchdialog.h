@@ -0,0 +1,33 @@
+#ifndef GLOBALSEARCHDIALOG_H
+#define GLOBALSEARCHDIALOG_H
+
+#include "ui_globalsearchdialog.h"
+
+class GlobalSearch;
+
+
+/*! \brief "Find in All Tabs" view.
+
+Lists the matching lines of all terminals as they are found. Double
+click brings the terminal to front: its own search bar finds lines
+still in the terminal's history, older lines are shown in its
+HistoryDialog.
+*/
+class GlobalSearchDialog : public QDialog, public Ui::GlobalSearchDialog
+{
+    Q_OBJECT
+public:
+    GlobalSearchDialog(QWidget *parent = 0);
+
+private:
+    GlobalSearch *m_search;
+    QString m_query;
+
+private slots:
+    void search();
+    void addHits(int first);
+    void searchFinished();
+    void activateHit(QTreeWidgetItem *item);
+};
+
+#endif
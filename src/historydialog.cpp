@@ -0,0 +1,148 @@
+#include <QAbstractListModel>
+#include <climits>
+
+#include "historydialog.h"
+#include "scrollbackarchive.h"
+#include "memoryaccounting.h"
+#include "termwidget.h"
+#include "properties.h"
+
+
+//! Lines of the archive, read on demand
+class HistoryModel : public QAbstractListModel
+{
+public:
+    HistoryModel(QObject *parent) : QAbstractListModel(parent), m_archive(0), m_count(0), m_dropped(0) {}
+
+    void setArchive(ScrollbackArchive *archive)
+    {
+        int count = archive ? (int)qMin<qint64>(archive->lineCount(), INT_MAX) : 0;
+        qint64 dropped = archive ? archive->droppedLines() : 0;
+        if (archive != m_archive || count < m_count || dropped != m_dropped)
+        {
+            // replaced, cleared or the oldest lines dropped
+            beginResetModel();
+            m_archive = archive;
+            m_count = count;
+            m_dropped = dropped;
+            endResetModel();
+        }
+        else if (count > m_count)
+        {
+            beginInsertRows(QModelIndex(), m_count, count - 1);
+            m_count = count;
+            endInsertRows();
+        }
+    }
+
+    ScrollbackArchive * archive() const { return m_archive; }
+
+    int rowCount(const QModelIndex & parent = QModelIndex()) const
+    {
+        return parent.isValid() ? 0 : m_count;
+    }
+
+    QVariant data(const QModelIndex & index, int role) const
+    {
+        if (role != Qt::DisplayRole || !m_archive || index.row() >= m_count)
+            return QVariant();
+        return m_archive->line(index.row());
+    }
+
+private:
+    ScrollbackArchive *m_archive;
+    int m_count;
+    qint64 m_dropped;
+};
+
+
+HistoryDialog::HistoryDialog(TermWidgetImpl *term)
+    : QDialog(term),
+      m_term(term)
+{
+    setupUi(this);
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    m_model = new HistoryModel(this);
+    historyView->setModel(m_model);
+    historyView->setFont(Properties::Instance()->font);
+
+    connect(findEdit, SIGNAL(returnPressed()), this, SLOT(findNext()));
+    connect(findNextButton, SIGNAL(clicked()), this, SLOT(findNext()));
+    connect(findPreviousButton, SIGNAL(clicked()), this, SLOT(findPrevious()));
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(sync()));
+    connect(term, SIGNAL(archiveStopped()), this, SLOT(archiveStopped()));
+    m_timer.start(1000);
+
+    sync();
+    historyView->scrollToBottom();
+}
+
+void HistoryDialog::sync()
+{
+    ScrollbackArchive *archive = m_term ? m_term->archive() : 0;
+    m_model->setArchive(archive);
+
+    if (!archive)
+    {
+        statusLabel->setText(tr("History is not archived"));
+        return;
+    }
+    QString status = tr("%n line(s), %1 on disk, %2 in memory", "", m_model->rowCount())
+                         .arg(MemoryAccounting::formatSize(archive->diskBytes()))
+                         .arg(MemoryAccounting::formatSize(archive->memoryBytes()));
+    if (archive->lostLines() > 0)
+        status += ", " + tr("%n line(s) lost - the disk is full", "", archive->lostLines());
+    statusLabel->setText(status);
+}
+
+void HistoryDialog::archiveStopped()
+{
+    m_model->setArchive(0);
+    statusLabel->setText(tr("History is not archived"));
+}
+
+void HistoryDialog::showLine(qint64 line, const QString & text)
+{
+    if (!text.isEmpty())
+        findEdit->setText(text);
+    if (line < 0 || line >= m_model->rowCount())
+        return;
+
+    QModelIndex index = m_model->index(line);
+    historyView->setCurrentIndex(index);
+    historyView->scrollTo(index, QAbstractItemView::PositionAtCenter);
+}
+
+void HistoryDialog::find(bool backwards)
+{
+    ScrollbackArchive *archive = m_model->archive();
+    if (!archive || findEdit->text().isEmpty())
+        return;
+
+    qint64 from;
+    QModelIndex current = historyView->currentIndex();
+    if (current.isValid())
+        from = current.row() + (backwards ? -1 : 1);
+    else
+        from = backwards ? archive->lineCount() - 1 : 0;
+
+    qint64 found = archive->find(findEdit->text(), from, backwards);
+    if (found < 0 || found >= m_model->rowCount())
+    {
+        statusLabel->setText(tr("\"%1\" not found").arg(findEdit->text()));
+        return;
+    }
+
+    showLine(found);
+}
+
+void HistoryDialog::findNext()
+{
+    find(false);
+}
+
+void HistoryDialog::findPrevious()
+{
+    find(true);
+}
@@ -0,0 +1,41 @@
+#ifndef HISTORYDIALOG_H
+#define HISTORYDIALOG_H
+
+#include <QPointer>
+#include <QTimer>
+
+#include "ui_historydialog.h"
+
+class TermWidgetImpl;
+class HistoryModel;
+
+
+/*! \brief "Full History" view of a terminal's ScrollbackArchive.
+
+The list fetches only the visible lines so it opens instantly even
+for millions of lines. New output is picked up once per second.
+*/
+class HistoryDialog : public QDialog, public Ui::HistoryDialog
+{
+    Q_OBJECT
+public:
+    HistoryDialog(TermWidgetImpl *term);
+
+    //! Scroll to \a line and put \a text in the find box
+    void showLine(qint64 line, const QString & text = QString());
+
+private:
+    QPointer<TermWidgetImpl> m_term;
+    HistoryModel *m_model;
+    QTimer m_timer;
+
+    void find(bool backwards);
+
+private slots:
+    void sync();
+    void archiveStopped();
+    void findNext();
+    void findPrevious();
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include <QApplication>
+#include <QKeyEvent>
+#include <QInputMethodEvent>
+
+#include "inputbroadcaster.h"
+#include "termwidget.h"
+
+
+InputBroadcaster * InputBroadcaster::m_instance = 0;
+
+
+InputBroadcaster * InputBroadcaster::Instance()
+{
+    if (!m_instance)
+        m_instance = new InputBroadcaster();
+    return m_instance;
+}
+
+InputBroadcaster::InputBroadcaster()
+    : QObject(0),
+      m_sending(false)
+{
+    // the next event loop pass
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(0);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+void InputBroadcaster::addTerminal(TermWidgetImpl * term)
+{
+    if (m_displays.contains(term))
+        return;
+
+    QWidget * display = term->display();
+    if (!display)
+        return;
+
+    m_displays[term] = display;
+    m_terminals[display] = term;
+    display->installEventFilter(this);
+}
+
+void InputBroadcaster::removeTerminal(TermWidgetImpl * term)
+{
+    QWidget * display = m_displays.take(term);
+    if (!display)
+        return;
+    m_terminals.remove(display);
+    display->removeEventFilter(this);
+
+    for (int i = m_pending.count() - 1; i >= 0; --i)
+    {
+        if (m_pending.at(i).source == term)
+            m_pending.removeAt(i);
+    }
+}
+
+void InputBroadcaster::paste(TermWidgetImpl * source, const QString & text)
+{
+    if (!m_displays.contains(source) || text.isEmpty())
+        return;
+    // the same as qtermwidget does with its own paste
+    QString t(text);
+    t.replace("\r\n", "\n");
+    t.replace('\n', '\r');
+    queue(source, 0, Qt::NoModifier, t);
+}
+
+bool InputBroadcaster::eventFilter(QObject * obj, QEvent * event)
+{
+    if (m_sending)
+        return false;
+
+    if (event->type() == QEvent::KeyPress)
+    {
+        QKeyEvent * e = static_cast<QKeyEvent*>(event);
+        Qt::KeyboardModifiers mods = e->modifiers() & ~Qt::ShiftModifier;
+        // printable text without modifiers is the same in any keyboard mode
+        if (mods == Qt::NoModifier && !e->text().isEmpty() && e->text().at(0).isPrint())
+            queue(m_terminals.value(obj), 0, Qt::NoModifier, e->text());
+        else
+            queue(m_terminals.value(obj), e->key(), e->modifiers(), e->text());
+    }
+    else if (event->type() == QEvent::InputMethod)
+    {
+        QInputMethodEvent * e = static_cast<QInputMethodEvent*>(event);
+        if (!e->commitString().isEmpty())
+            queue(m_terminals.value(obj), 0, Qt::NoModifier, e->commitString());
+    }
+    // the source terminal handles it as usual
+    return false;
+}
+
+void InputBroadcaster::queue(TermWidgetImpl * source, int key, Qt::KeyboardModifiers modifiers,
+                             const QString & text)
+{
+    if (!source)
+        return;
+
+    if (key == 0 && !m_pending.isEmpty())
+    {
+        Input & last = m_pending.last();
+        if (last.source == source && last.key == 0)
+        {
+            last.text += text;
+            return;
+        }
+    }
+
+    Input in;
+    in.source = source;
+    in.key = key;
+    in.modifiers = modifiers;
+    in.text = text;
+    m_pending.append(in);
+    if (!m_timer.isActive())
+        m_timer.start();
+}
+
+void InputBroadcaster::flush()
+{
+    QList<Input> pending = m_pending;
+    m_pending.clear();
+    if (pending.isEmpty())
+        return;
+
+    m_sending = true;
+    QHash<TermWidgetImpl*, QWidget*>::const_iterator it = m_displays.constBegin();
+    while (it != m_displays.constEnd())
+    {
+        foreach (const Input & in, pending)
+        {
+            if (in.source == it.key())
+                continue;
+            // a key press without a key code is sent as its text (see Vt102Emulation)
+            QKeyEvent e(QEvent::KeyPress, in.key, in.modifiers, in.text);
+            QApplication::sendEvent(it.value(), &e);
+        }
+        ++it;
+    }
+    m_sending = false;
+}
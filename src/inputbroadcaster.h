@@ -0,0 +1,70 @@
+#ifndef INPUTBROADCASTER_H
+#define INPUTBROADCASTER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+
+class TermWidgetImpl;
+
+
+/*! \brief Input typed into one synchronized terminal goes to all of them.
+
+See TermWidgetHolder::setSynchronizeInput(). All terminals of all
+synchronized tabs - in any window - form one group.
+
+Key presses are caught by an event filter on the terminal displays
+and queued. The queue is delivered once per event loop pass: runs of
+plain text are merged, so each other terminal gets one write per pass
+however many terminals there are and however fast the typing is.
+qtermwidget doesn't give access to its pty - the input goes through
+each terminal's own display and emulation, which also encode the
+special keys for the terminal's current keyboard mode.
+*/
+class InputBroadcaster : public QObject
+{
+    Q_OBJECT
+
+    public:
+        static InputBroadcaster * Instance();
+
+        void addTerminal(TermWidgetImpl * term);
+        void removeTerminal(TermWidgetImpl * term);
+        bool contains(TermWidgetImpl * term) const { return m_displays.contains(term); }
+
+        //! \a text has been pasted into \a source
+        void paste(TermWidgetImpl * source, const QString & text);
+
+    protected:
+        bool eventFilter(QObject * obj, QEvent * event);
+
+    private:
+        InputBroadcaster();
+
+        static InputBroadcaster * m_instance;
+
+        struct Input {
+            TermWidgetImpl * source;
+            //! 0 for text
+            int key;
+            Qt::KeyboardModifiers modifiers;
+            QString text;
+        };
+
+        //! TerminalDisplay of each synchronized terminal
+        QHash<TermWidgetImpl*, QWidget*> m_displays;
+        QHash<QObject*, TermWidgetImpl*> m_terminals;
+        QList<Input> m_pending;
+        QTimer m_timer;
+        //! delivering m_pending - don't queue it again
+        bool m_sending;
+
+        void queue(TermWidgetImpl * source, int key, Qt::KeyboardModifiers modifiers,
+                   const QString & text);
+
+    private slots:
+        void flush();
+};
+
+#endif
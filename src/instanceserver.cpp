@@ -0,0 +1,280 @@
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#endif
+
+#include "instanceserver.h"
+#include "mainwindow.h"
+#include "tabwidget.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+//! a work directory and a command - anything longer is not a request
+static const int MAX_REQUEST_SIZE = 64 * 1024;
+
+
+/*! Create \a dir for the socket or check the existing one: it must be
+    a real directory of this user nobody else can enter. Otherwise
+    another user could listen instead of us or talk to us.
+ */
+static bool privateDirectory(const QString & dir)
+{
+#ifdef Q_OS_UNIX
+    QByteArray path = QFile::encodeName(dir);
+    if (::mkdir(path.constData(), 0700) != 0 && errno != EEXIST)
+        return false;
+
+    struct stat st;
+    if (::lstat(path.constData(), &st) != 0)
+        return false;
+    if (!S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 077))
+    {
+        qWarning() << "InstanceServer:" << dir << "is not a private directory of this user";
+        return false;
+    }
+    return true;
+#else
+    return QDir().mkpath(dir);
+#endif
+}
+
+//! Is the other end of \a socket run by this user?
+static bool samePeerUser(QLocalSocket * socket)
+{
+#if defined(Q_OS_LINUX) && defined(SO_PEERCRED)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (::getsockopt(socket->socketDescriptor(), SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+        return false;
+    return cred.uid == getuid();
+#elif defined(Q_OS_UNIX)
+    uid_t uid;
+    gid_t gid;
+    if (::getpeereid(socket->socketDescriptor(), &uid, &gid) != 0)
+        return false;
+    return uid == getuid();
+#else
+    Q_UNUSED(socket);
+    return true;
+#endif
+}
+
+
+InstanceServer::InstanceServer(const QString & profile, QObject * parent)
+    : QObject(parent),
+      m_path(socketPath(profile)),
+      m_server(0)
+{
+}
+
+InstanceServer::~InstanceServer()
+{
+    if (m_server)
+        m_server->close();
+}
+
+QString InstanceServer::socketPath(const QString & profile)
+{
+    QString dir = QString::fromLocal8Bit(qgetenv("XDG_RUNTIME_DIR"));
+    if (dir.isEmpty() || !QFileInfo(dir).isDir())
+        dir = QDir::tempPath();
+
+#ifdef Q_OS_UNIX
+    dir += QString("/qterminal-%1").arg(getuid());
+#else
+    dir += QString("/qterminal-%1").arg(QString::fromLocal8Bit(qgetenv("USERNAME")));
+#endif
+    QString name("instance");
+    // each profile (-p) has its own settings so it gets its own instance
+    if (!profile.isEmpty())
+    {
+        QByteArray key = QFileInfo(profile).absoluteFilePath().toUtf8();
+        name += '-' + QString(QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex().left(8));
+    }
+
+    return dir + '/' + name;
+}
+
+bool InstanceServer::listen()
+{
+    if (m_server)
+        return m_server->isListening();
+
+    if (!privateDirectory(QFileInfo(m_path).path()))
+        return false;
+
+    // Do not steal the socket from another living instance (eg. started
+    // with -d which never forwards its request).
+    QLocalSocket probe;
+    probe.connectToServer(m_path);
+    if (probe.waitForConnected(100))
+    {
+        probe.disconnectFromServer();
+        qDebug() << "InstanceServer: another instance is listening on" << m_path;
+        return false;
+    }
+
+    // nobody answers - it's a leftover from a crashed instance
+    QLocalServer::removeServer(m_path);
+
+    m_server = new QLocalServer(this);
+#if QT_VERSION >= 0x050000
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+#endif
+    if (!m_server->listen(m_path))
+    {
+        qDebug() << "InstanceServer: cannot listen on" << m_path << m_server->errorString();
+        return false;
+    }
+
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    return true;
+}
+
+void InstanceServer::newConnection()
+{
+    while (QLocalSocket * socket = m_server->nextPendingConnection())
+    {
+        if (!samePeerUser(socket))
+        {
+            qWarning() << "InstanceServer: request of another user refused";
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+void InstanceServer::readRequest()
+{
+    QLocalSocket * socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket)
+        return;
+
+    // request format: "workdir\0command\0tab\0" - tab is "1" or empty
+    QByteArray data = socket->peek(qMin<qint64>(socket->bytesAvailable(), MAX_REQUEST_SIZE));
+    if (data.count('\0') < 3)
+    {
+        if (data.size() >= MAX_REQUEST_SIZE)
+        {
+            qWarning() << "InstanceServer: request too long, refused";
+            socket->abort();
+        }
+        return;
+    }
+    socket->readAll();
+    socket->disconnectFromServer();
+
+    QList<QByteArray> parts = data.split('\0');
+    QString workdir = QString::fromUtf8(parts.at(0));
+    QString command = QString::fromUtf8(parts.at(1));
+    bool tab = !parts.at(2).isEmpty();
+    qDebug() << "InstanceServer:" << (tab ? "new tab request" : "new window request")
+             << workdir << command;
+
+    MainWindow *w = tab ? tabWindow() : 0;
+    if (w)
+    {
+        TabWidget *tabs = w->findChild<TabWidget*>("consoleTabulator");
+        // it becomes a real tab with setCurrentIndex() - see materializeTab()
+        tabs->setCurrentIndex(tabs->addDeferredTab(QString(), workdir, command));
+    }
+    else
+        w = new MainWindow(workdir, command, false);
+    w->show();
+    w->raise();
+    w->activateWindow();
+}
+
+MainWindow * InstanceServer::tabWindow()
+{
+    MainWindow *ret = 0;
+    foreach (MainWindow *w, MainWindow::windows())
+    {
+        // the drop down comes and goes with its shortcut
+        if (w->dropMode() || !w->findChild<TabWidget*>("consoleTabulator"))
+            continue;
+        if (w->isActiveWindow())
+            return w;
+        if (!ret)
+            ret = w;
+    }
+    return ret;
+}
+
+bool InstanceServer::sendRequest(const QString & profile,
+                                 const QString & workdir,
+                                 const QString & command,
+                                 bool tab)
+{
+#ifdef Q_OS_UNIX
+    QString socket = socketPath(profile);
+    // never hand the command to whoever has prepared the path for us
+    if (!privateDirectory(QFileInfo(socket).path()))
+        return false;
+    QByteArray path = QFile::encodeName(socket);
+
+    struct sockaddr_un addr;
+    if (path.size() >= (int)sizeof(addr.sun_path))
+        return false;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.constData(), path.size());
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+
+    if (::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    QByteArray request;
+    request.append(workdir.toUtf8());
+    request.append('\0');
+    request.append(command.toUtf8());
+    request.append('\0');
+    if (tab)
+        request.append('1');
+    request.append('\0');
+
+    const char *buf = request.constData();
+    int left = request.size();
+    while (left > 0)
+    {
+        ssize_t written = ::send(fd, buf, left, MSG_NOSIGNAL);
+        if (written <= 0)
+            break;
+        buf += written;
+        left -= written;
+    }
+    ::close(fd);
+
+    return left == 0;
+#else
+    Q_UNUSED(profile);
+    Q_UNUSED(workdir);
+    Q_UNUSED(command);
+    Q_UNUSED(tab);
+    return false;
+#endif
+}
@@ -0,0 +1,52 @@
+#ifndef INSTANCESERVER_H
+#define INSTANCESERVER_H
+
+#include <QObject>
+
+class QLocalServer;
+class MainWindow;
+
+
+/*! \brief Single-instance support.
+
+The first qterminal process (with "SingleInstance" enabled) listens on
+a per-user, per-profile local socket in a directory only the user can
+enter; requests of other users are refused. Later invocations hand their
+work directory and command over with sendRequest() and exit before
+a QApplication is ever constructed - the running process opens a new
+window for them instead, or a new tab in its active window (--tab).
+*/
+class InstanceServer : public QObject
+{
+    Q_OBJECT
+
+    public:
+        InstanceServer(const QString & profile, QObject * parent=0);
+        ~InstanceServer();
+
+        bool listen();
+
+        /*! Pass the request to a running instance. It uses plain sockets
+            only so it can be called before QApplication is created.
+            Returns true if the request has been delivered.
+            With \a tab set it opens a tab instead of a window.
+         */
+        static bool sendRequest(const QString & profile,
+                                const QString & workdir,
+                                const QString & command,
+                                bool tab);
+
+    private:
+        QString m_path;
+        QLocalServer * m_server;
+
+        static QString socketPath(const QString & profile);
+        //! The window to open a requested tab in, 0 if there is none
+        static MainWindow * tabWindow();
+
+    private slots:
+        void newConnection();
+        void readRequest();
+};
+
+#endif
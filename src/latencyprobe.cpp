@@ -0,0 +1,241 @@
+#include <QLabel>
+#include <QTimer>
+#include <QKeyEvent>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QtAlgorithms>
+#include <QDebug>
+
+#include "latencyprobe.h"
+#include "termwidget.h"
+#include "properties.h"
+
+
+static const int MAX_SAMPLES = 10000;
+//! key presses nobody answers (eg. a password prompt) are dropped over this
+static const int MAX_PENDING = 256;
+//! microseconds - a key press without any echo after this was not echoed
+static const qint64 MAX_ECHO_WAIT = 1000000;
+
+static QString s_output;
+static QList<LatencyProbe*> s_probes;
+//! summaries of terminals closed already
+static QStringList s_closed;
+
+
+static QString jsonEscape(const QString & str)
+{
+    QString s = str;
+    s.replace('\\', "\\\\");
+    s.replace('"', "\\\"");
+    return s;
+}
+
+//! Does the key write anything to the pty? Not modifiers, Caps Lock etc.
+static bool producesInput(QKeyEvent * event)
+{
+    if (!event->text().isEmpty())
+        return true;
+    int key = event->key();
+    // the keys the emulation translates to escape sequences
+    return (key >= Qt::Key_Home && key <= Qt::Key_PageDown)
+            || (key >= Qt::Key_F1 && key <= Qt::Key_F35)
+            || key == Qt::Key_Insert || key == Qt::Key_Delete;
+}
+
+
+void LatencyProbe::Samples::add(qint64 usec)
+{
+    if (values.count() >= MAX_SAMPLES)
+        values.remove(0, MAX_SAMPLES / 2);
+    values.append(usec);
+}
+
+double LatencyProbe::Samples::percentile(double p) const
+{
+    if (values.isEmpty())
+        return 0;
+    QVector<qint64> sorted = values;
+    qSort(sorted);
+    int i = qMin(sorted.count() - 1, (int)(p * sorted.count()));
+    return sorted.at(i) / 1000.0;
+}
+
+
+void LatencyProbe::setOutput(const QString & fname)
+{
+    s_output = fname;
+}
+
+bool LatencyProbe::isEnabled()
+{
+    return !s_output.isEmpty();
+}
+
+LatencyProbe::LatencyProbe(TermWidgetImpl * term)
+    : QObject(term),
+      m_term(term),
+      m_display(term->display() ? term->display() : term)
+{
+    m_display->installEventFilter(this);
+
+    // receivedData() is not available in older qtermwidget
+    m_hasEcho = term->metaObject()->indexOfSignal("receivedData(QString)") != -1;
+    if (m_hasEcho)
+        connect(term, SIGNAL(receivedData(QString)), this, SLOT(receivedData(QString)));
+
+    // opaque so its updates do not repaint the display under it
+    m_overlay = new QLabel(term);
+    m_overlay->setAutoFillBackground(true);
+    QFont f = m_overlay->font();
+    f.setPointSize(qMax(6, f.pointSize() - 2));
+    m_overlay->setFont(f);
+    m_overlay->show();
+
+    QTimer * timer = new QTimer(this);
+    connect(timer, SIGNAL(timeout()), this, SLOT(updateOverlay()));
+    timer->start(1000);
+
+    m_clock.start();
+    s_probes.append(this);
+    updateOverlay();
+}
+
+LatencyProbe::~LatencyProbe()
+{
+    s_probes.removeAll(this);
+    if (!m_keyToPaint.values.isEmpty())
+        s_closed.append(summary());
+}
+
+bool LatencyProbe::eventFilter(QObject * obj, QEvent * event)
+{
+    if (obj != m_display)
+        return false;
+
+    switch (event->type())
+    {
+        case QEvent::KeyPress:
+        {
+            QKeyEvent * key = static_cast<QKeyEvent*>(event);
+            if (m_keys.count() < MAX_PENDING && producesInput(key))
+            {
+                PendingKey pending = { m_clock.nsecsElapsed() / 1000, key->text() };
+                m_keys.enqueue(pending);
+            }
+            break;
+        }
+        case QEvent::Paint:
+        {
+            qint64 now = m_clock.nsecsElapsed() / 1000;
+            if (m_hasEcho)
+            {
+                while (!m_echoed.isEmpty())
+                    m_keyToPaint.add(now - m_echoed.dequeue());
+            }
+            else
+            {
+                // without the echo stage any paint after the key counts
+                while (!m_keys.isEmpty())
+                    m_keyToPaint.add(now - m_keys.dequeue().time);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return false;
+}
+
+void LatencyProbe::receivedData(const QString & data)
+{
+    qint64 now = m_clock.nsecsElapsed() / 1000;
+    int from = 0;
+    // a chunk of output may echo several keys at once
+    while (!m_keys.isEmpty())
+    {
+        const PendingKey & key = m_keys.head();
+        if (now - key.time > MAX_ECHO_WAIT)
+        {
+            m_keys.dequeue();
+            continue;
+        }
+        // a printable key is echoed as itself, anything else (Enter,
+        // arrows, control keys) by whatever the shell answers
+        if (key.text.count() == 1 && key.text.at(0).isPrint())
+        {
+            int i = data.indexOf(key.text, from);
+            // eg. tail -f output - not an echo
+            if (i == -1)
+                break;
+            from = i + 1;
+        }
+        m_keyToEcho.add(now - key.time);
+        m_echoed.enqueue(key.time);
+        m_keys.dequeue();
+    }
+}
+
+void LatencyProbe::updateOverlay()
+{
+    QString text = tr("key-to-paint p50 %1 p95 %2 p99 %3 ms")
+                    .arg(m_keyToPaint.percentile(0.50), 0, 'f', 1)
+                    .arg(m_keyToPaint.percentile(0.95), 0, 'f', 1)
+                    .arg(m_keyToPaint.percentile(0.99), 0, 'f', 1);
+    if (m_hasEcho)
+        text += tr(" (echo p99 %1 ms)").arg(m_keyToEcho.percentile(0.99), 0, 'f', 1);
+    m_overlay->setText(text);
+    m_overlay->adjustSize();
+    m_overlay->move(m_term->width() - m_overlay->width() - 4, 4);
+    m_overlay->raise();
+}
+
+QString LatencyProbe::summary() const
+{
+    Properties * p = Properties::Instance();
+    QString ret;
+    QTextStream out(&ret);
+    out << "{\"terminal\":\"" << jsonEscape(m_term->objectName()) << "\","
+        << "\"samples\":" << m_keyToPaint.values.count() << ","
+        << "\"echo\":" << (m_hasEcho ? "true" : "false") << ",";
+    if (m_hasEcho)
+    {
+        out << "\"key_to_echo_ms\":{"
+            << "\"p50\":" << m_keyToEcho.percentile(0.50) << ","
+            << "\"p95\":" << m_keyToEcho.percentile(0.95) << ","
+            << "\"p99\":" << m_keyToEcho.percentile(0.99) << "},";
+    }
+    out << "\"key_to_paint_ms\":{"
+        << "\"p50\":" << m_keyToPaint.percentile(0.50) << ","
+        << "\"p95\":" << m_keyToPaint.percentile(0.95) << ","
+        << "\"p99\":" << m_keyToPaint.percentile(0.99) << "},"
+        // the settings being compared
+        << "\"font\":\"" << jsonEscape(p->font.toString()) << "\","
+        << "\"terminal_transparency\":" << p->termTransparency << ","
+        << "\"history\":" << (p->historyLimited ? (int)p->historyLimitedTo : -1) << ","
+        << "\"color_scheme\":\"" << jsonEscape(p->colorScheme) << "\"}";
+    out.flush();
+    return ret;
+}
+
+void LatencyProbe::dump()
+{
+    if (!isEnabled())
+        return;
+
+    QFile f(s_output);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        qDebug() << "LatencyProbe: cannot write to" << s_output;
+        return;
+    }
+
+    QStringList all = s_closed;
+    foreach (LatencyProbe * probe, s_probes)
+        all.append(probe->summary());
+
+    QTextStream out(&f);
+    out << "{\"terminals\":[\n" << all.join(",\n") << "\n]}\n";
+    qDebug() << "LatencyProbe: written to" << s_output;
+}
@@ -0,0 +1,80 @@
+#ifndef LATENCYPROBE_H
+#define LATENCYPROBE_H
+
+#include <QObject>
+#include <QQueue>
+#include <QVector>
+#include <QElapsedTimer>
+
+class QLabel;
+class TermWidgetImpl;
+
+
+/*! \brief Keystroke-to-paint latency measurement (--latency-probe).
+
+Each key press on the terminal display which writes to the pty is
+timestamped. Then it is matched to the first output coming back from
+the pty which echoes it (a printable key must appear in the output,
+other keys take any output) and to the first paint of the display
+after it. Keys not echoed within a second are dropped. Percentiles
+are shown in a small overlay in the top right corner of every terminal
+and written to the output file when qterminal exits.
+
+The echo stage needs QTermWidget::receivedData() which older
+qtermwidget versions do not have. Then only key-to-paint is measured.
+*/
+class LatencyProbe : public QObject
+{
+    Q_OBJECT
+
+    public:
+        explicit LatencyProbe(TermWidgetImpl * term);
+        ~LatencyProbe();
+
+        //! Set the output file. Empty name disables the probes
+        static void setOutput(const QString & fname);
+        static bool isEnabled();
+        //! Write the results of all terminals, even the closed ones
+        static void dump();
+
+    protected:
+        bool eventFilter(QObject * obj, QEvent * event);
+
+    private:
+        struct PendingKey
+        {
+            //! microseconds
+            qint64 time;
+            QString text;
+        };
+
+        struct Samples
+        {
+            //! microseconds, the last MAX_SAMPLES only
+            QVector<qint64> values;
+            void add(qint64 usec);
+            double percentile(double p) const;
+        };
+
+        TermWidgetImpl * m_term;
+        QWidget * m_display;
+        QLabel * m_overlay;
+        bool m_hasEcho;
+
+        QElapsedTimer m_clock;
+        //! key presses waiting for the echo
+        QQueue<PendingKey> m_keys;
+        //! key presses echoed, waiting for the paint
+        QQueue<qint64> m_echoed;
+
+        Samples m_keyToEcho;
+        Samples m_keyToPaint;
+
+        QString summary() const;
+
+    private slots:
+        void receivedData(const QString & data);
+        void updateOverlay();
+};
+
+#endif
@@ -26,10 +26,22 @@
 #include <stdlib.h>
 
 #include  "mainwindow.h"
+#include "instanceserver.h"
+#include "startuptrace.h"
+#include "latencyprobe.h"
+#include "memoryaccounting.h"
+#include "sessionlog.h"
 
 #define out
 
-const char* const short_options = "vhw:e:dp:";
+// long-only options
+enum {
+    TRACE_STARTUP_OPTION = 256,
+    LATENCY_PROBE_OPTION,
+    MEMORY_REPORT_OPTION
+};
+
+const char* const short_options = "vhw:e:dp:st";
 
 const struct option long_options[] = {
     {"version", 0, NULL, 'v'},
@@ -38,6 +50,11 @@ const struct option long_options[] = {
     {"execute", 1, NULL, 'e'},
     {"drop",    0, NULL, 'd'},
     {"profile", 1, NULL, 'p'},
+    {"standalone", 0, NULL, 's'},
+    {"tab",     0, NULL, 't'},
+    {"trace-startup", 1, NULL, TRACE_STARTUP_OPTION},
+    {"latency-probe", 1, NULL, LATENCY_PROBE_OPTION},
+    {"memory-report", 1, NULL, MEMORY_REPORT_OPTION},
     {NULL,      0, NULL,  0}
 };
 
@@ -49,8 +66,13 @@ void print_usage_and_exit(int code)
     puts("  -e,  --execute <command>  Execute command instead of shell");
     puts("  -h,  --help               Print this help");
     puts("  -p,  --profile            Load qterminal with specific options");
+    puts("  -s,  --standalone         Do not pass the request to a running instance");
+    puts("  -t,  --tab                Open a tab in a running instance instead of a window");
     puts("  -v,  --version            Prints application version and exits");
     puts("  -w,  --workdir <dir>      Start session with specified work directory");
+    puts("       --trace-startup <file>  Write startup phase timings as Chrome trace-event JSON");
+    puts("       --latency-probe <file>  Measure keystroke-to-paint latency, write it on exit");
+    puts("       --memory-report <file>  Write per-terminal memory usage on SIGUSR1 and on exit");
     puts("\nHomepage: <https://github.com/qterminal>");
     puts("Report bugs to <https://github.com/qterminal/qterminal>");
     exit(code);
@@ -62,7 +84,7 @@ void print_version_and_exit(int code=0)
     exit(code);
 }
 
-void parse_args(int argc, char* argv[], QString& workdir, QString & shell_command, out bool& dropMode)
+void parse_args(int argc, char* argv[], QString& workdir, QString & shell_command, out bool& dropMode, out QString& profile, out QString& traceFile, out QString& latencyFile, out QString& memoryFile)
 {
     int next_option;
     dropMode = false;
@@ -89,7 +111,20 @@ void parse_args(int argc, char* argv[], QString& workdir, QString & shell_comman
                 dropMode = true;
                 break;
             case 'p':
-                Properties::Instance(QString(optarg));
+                profile = QString(optarg);
+                Properties::Instance(profile);
+                break;
+            case 's':
+            case 't':
+                break;
+            case TRACE_STARTUP_OPTION:
+                traceFile = QString(optarg);
+                break;
+            case LATENCY_PROBE_OPTION:
+                latencyFile = QString(optarg);
+                break;
+            case MEMORY_REPORT_OPTION:
+                memoryFile = QString(optarg);
                 break;
             case '?':
                 print_usage_and_exit(1);
@@ -100,20 +135,88 @@ void parse_args(int argc, char* argv[], QString& workdir, QString & shell_comman
     while(next_option != -1);
 }
 
+/*! Hand the command line over to a running single instance.
+    It's called before QApplication is constructed so it must not depend
+    on anything but plain getopt. Qt's own arguments, -d, -h, -v and -s
+    always start a standalone process.
+ */
+bool forward_to_running_instance(int argc, char* argv[])
+{
+    QString workdir, shell_command, profile;
+    bool forward = true;
+    bool tab = false;
+
+    // work on a copy - GNU getopt permutes argv and QApplication needs it intact
+    QVector<char*> args;
+    for (int i = 0; i < argc; ++i)
+        args << argv[i];
+    args << 0;
+
+    opterr = 0;
+    int next_option;
+    while (forward && (next_option = getopt_long(argc, args.data(), short_options, long_options, NULL)) != -1)
+    {
+        switch(next_option)
+        {
+            case 'w':
+                workdir = QString(optarg);
+                break;
+            case 'e':
+                shell_command = QString(optarg);
+                while (optind < argc)
+                    shell_command += ' ' + QString(args[optind++]);
+                break;
+            case 'p':
+                profile = QString(optarg);
+                break;
+            case 't':
+                tab = true;
+                break;
+            default:
+                forward = false;
+        }
+    }
+    // reset getopt for the real parse_args() run
+    opterr = 1;
+    optind = 0;
+
+    if (!forward)
+        return false;
+
+    // the running instance has another current directory
+    if (workdir.isEmpty())
+        workdir = QDir::currentPath();
+    else
+        workdir = QDir(workdir).absolutePath();
+
+    return InstanceServer::sendRequest(profile, workdir, shell_command, tab);
+}
+
 int main(int argc, char *argv[])
 {
+    StartupTrace::start();
     setenv("TERM", "xterm", 1); // TODO/FIXME: why?
 
+    if (forward_to_running_instance(argc, argv))
+        return 0;
+
     QApplication::setApplicationName("qterminal");
     QApplication::setApplicationVersion(STR_VERSION);
     QApplication::setOrganizationDomain("qterminal.org");
     // Warning: do not change settings format. It can screw bookmarks later.
     QSettings::setDefaultFormat(QSettings::IniFormat);
 
+    qint64 appBegin = StartupTrace::now();
     QApplication app(argc, argv);
-    QString workdir, shell_command;
+    StartupTrace::addSpan("QApplication", appBegin, StartupTrace::now());
+
+    QString workdir, shell_command, profile, traceFile, latencyFile, memoryFile;
     bool dropMode;
-    parse_args(argc, argv, workdir, shell_command, dropMode);
+    parse_args(argc, argv, workdir, shell_command, dropMode, profile, traceFile, latencyFile, memoryFile);
+    StartupTrace::setOutput(traceFile);
+    LatencyProbe::setOutput(latencyFile);
+    if (!memoryFile.isEmpty())
+        MemoryAccounting::Instance()->setOutput(memoryFile);
 
     if (workdir.isEmpty())
         workdir = QDir::currentPath();
@@ -124,6 +227,7 @@ int main(int argc, char *argv[])
         QIcon::setThemeName("QTerminal");
 
     // translations
+    qint64 translatorBegin = StartupTrace::now();
     QString fname = QString("qterminal_%1.qm").arg(QLocale::system().name().left(2));
     QTranslator translator;
 #ifdef TRANSLATIONS_DIR
@@ -135,7 +239,15 @@ int main(int argc, char *argv[])
     qDebug() << "load success:" << translator.load(fname, QApplication::applicationDirPath()+"../translations", "_");
 #endif
     app.installTranslator(&translator);
+    StartupTrace::addSpan("load translations", translatorBegin, StartupTrace::now());
+
+    // settings are shared by all windows of this process
+    Properties::Instance()->migrate_settings();
+    Properties::Instance()->loadSettings();
+    if (!Properties::Instance()->guiStyle.isEmpty())
+        QApplication::setStyle(Properties::Instance()->guiStyle);
 
+    qint64 windowBegin = StartupTrace::now();
     MainWindow *window;
     if (dropMode)
     {
@@ -150,5 +262,20 @@ int main(int argc, char *argv[])
         window->show();
     }
 
-    return app.exec();
+    StartupTrace::addSpan("MainWindow", windowBegin, StartupTrace::now());
+
+    InstanceServer server(profile);
+    if (Properties::Instance()->singleInstance)
+        server.listen();
+
+    int ret = app.exec();
+    // closeEvent() only schedules the save
+    Properties::Instance()->syncSettings();
+    SessionLog::shutdown();
+    LatencyProbe::dump();
+    if (!memoryFile.isEmpty())
+        MemoryAccounting::Instance()->writeOutput();
+    // nothing has been painted (eg. hidden drop mode) - write what we have
+    StartupTrace::finish();
+    return ret;
 }
@@ -22,6 +22,8 @@
 #include <QDesktopWidget>
 #include <QToolButton>
 #include <QMessageBox>
+#include <QInputDialog>
+#include <QStyle>
 
 #include "mainwindow.h"
 #include "tabwidget.h"
@@ -30,11 +32,20 @@
 #include "properties.h"
 #include "propertiesdialog.h"
 #include "bookmarkswidget.h"
+#include "memorydialog.h"
+#include "globalsearchdialog.h"
+#include "commandpalette.h"
+#include "sessionstate.h"
+#include "startuptrace.h"
 
 
 // TODO/FXIME: probably remove. QSS makes it unusable on mac...
 #define QSS_DROP    "MainWindow {border: 1px solid rgba(0, 0, 0, 50%);}\n"
 
+//! set by loadSession() while it creates a window
+static bool s_restoring = false;
+
+
 MainWindow::MainWindow(const QString& work_dir,
                        const QString& command,
                        bool dropMode,
@@ -44,19 +55,16 @@ MainWindow::MainWindow(const QString& work_dir,
       m_initShell(command),
       m_initWorkDir(work_dir),
       m_dropLockButton(0),
-      m_dropMode(dropMode)
+      m_dropMode(dropMode),
+      m_menusPopulated(false)
 {
+    // settings are loaded once per process in main()
     setupUi(this);
-    Properties::Instance()->migrate_settings();
-    Properties::Instance()->loadSettings();
 
+    // BookmarksWidget is created when the dock is shown for the first time
     m_bookmarksDock = new QDockWidget(tr("Bookmarks"), this);
     m_bookmarksDock->setObjectName("BookmarksDockWidget");
-    BookmarksWidget *bookmarksWidget = new BookmarksWidget(m_bookmarksDock);
-    m_bookmarksDock->setWidget(bookmarksWidget);
     addDockWidget(Qt::LeftDockWidgetArea, m_bookmarksDock);
-    connect(bookmarksWidget, SIGNAL(callCommand(QString)),
-            this, SLOT(bookmarksWidget_callCommand(QString)));
 
     connect(m_bookmarksDock, SIGNAL(visibilityChanged(bool)),
             this, SLOT(bookmarksDock_visibilityChanged(bool)));
@@ -65,6 +73,11 @@ MainWindow::MainWindow(const QString& work_dir,
     connect(actAboutQt, SIGNAL(triggered()), qApp, SLOT(aboutQt()));
     connect(&m_dropShortcut, SIGNAL(activated()), SLOT(showHide()));
 
+    // one process serves all windows (single instance) - a closed window
+    // must take its shells with it. The drop down is only ever hidden.
+    if (!m_dropMode)
+        setAttribute(Qt::WA_DeleteOnClose);
+
     setContentsMargins(0, 0, 0, 0);
     if (m_dropMode) {
         this->enableDropMode();
@@ -79,14 +92,20 @@ MainWindow::MainWindow(const QString& work_dir,
     consoleTabulator->setWorkDirectory(work_dir);
     consoleTabulator->setTabPosition((QTabWidget::TabPosition)Properties::Instance()->tabsPos);
     //consoleTabulator->setShellProgram(command);
-    consoleTabulator->addNewTab(command);
+    // loadSession() adds the tabs itself
+    if (!s_restoring)
+        consoleTabulator->addNewTab(command);
 
     setWindowTitle("QTerminal");
     setWindowIcon(QIcon::fromTheme("utilities-terminal"));
 
-    setup_FileMenu_Actions();
-    setup_ActionsMenu_Actions();
-    setup_ViewMenu_Actions();
+    setupActions();
+    // apply the window's own settings - the terminals have applied theirs
+    // and the style is set in main()
+    propertiesChanged(Properties::WindowOptions | Properties::Shortcuts | Properties::Bookmarks);
+    // the dialog of any window or an edited settings file
+    connect(Properties::Instance(), SIGNAL(changed(Properties::Changes)),
+            this, SLOT(propertiesChanged(Properties::Changes)));
 
     // Add global rename Session shortcut
     renameSession = new QAction(tr("Rename Session"), this);
@@ -126,267 +145,85 @@ void MainWindow::setDropShortcut(QKeySequence dropShortCut)
     }
 }
 
-void MainWindow::setup_ActionsMenu_Actions()
-{
-    QSettings settings;
-    settings.beginGroup("Shortcuts");
-
-    QKeySequence seq;
-
-    Properties::Instance()->actions[CLEAR_TERMINAL] = new QAction(QIcon::fromTheme("edit-clear"), tr("Clear Current Tab"), this);
-    seq = QKeySequence::fromString(settings.value(CLEAR_TERMINAL, CLEAR_TERMINAL_SHORTCUT).toString());
-    Properties::Instance()->actions[CLEAR_TERMINAL]->setShortcut(seq);
-    connect(Properties::Instance()->actions[CLEAR_TERMINAL], SIGNAL(triggered()), consoleTabulator, SLOT(clearActiveTerminal()));
-    menu_Actions->addAction(Properties::Instance()->actions[CLEAR_TERMINAL]);
-    addAction(Properties::Instance()->actions[CLEAR_TERMINAL]);
-
-    menu_Actions->addSeparator();
-
-    Properties::Instance()->actions[TAB_NEXT] = new QAction(QIcon::fromTheme("go-next"), tr("Next Tab"), this);
-    seq = QKeySequence::fromString( settings.value(TAB_NEXT, TAB_NEXT_SHORTCUT).toString() );
-    Properties::Instance()->actions[TAB_NEXT]->setShortcut(seq);
-    connect(Properties::Instance()->actions[TAB_NEXT], SIGNAL(triggered()), consoleTabulator, SLOT(switchToRight()));
-    menu_Actions->addAction(Properties::Instance()->actions[TAB_NEXT]);
-    addAction(Properties::Instance()->actions[TAB_NEXT]);
-
-    Properties::Instance()->actions[TAB_PREV] = new QAction(QIcon::fromTheme("go-previous"), tr("Previous Tab"), this);
-    seq = QKeySequence::fromString( settings.value(TAB_PREV, TAB_PREV_SHORTCUT).toString() );
-    Properties::Instance()->actions[TAB_PREV]->setShortcut(seq);
-    connect(Properties::Instance()->actions[TAB_PREV], SIGNAL(triggered()), consoleTabulator, SLOT(switchToLeft()));
-    menu_Actions->addAction(Properties::Instance()->actions[TAB_PREV]);
-    addAction(Properties::Instance()->actions[TAB_PREV]);
-
-    Properties::Instance()->actions[MOVE_LEFT] = new QAction(tr("Move Tab Left"), this);
-    seq = QKeySequence::fromString( settings.value(MOVE_LEFT, MOVE_LEFT_SHORTCUT).toString() );
-    Properties::Instance()->actions[MOVE_LEFT]->setShortcut(seq);
-    connect(Properties::Instance()->actions[MOVE_LEFT], SIGNAL(triggered()), consoleTabulator, SLOT(moveLeft()));
-    menu_Actions->addAction(Properties::Instance()->actions[MOVE_LEFT]);
-    addAction(Properties::Instance()->actions[MOVE_LEFT]);
-
-    Properties::Instance()->actions[MOVE_RIGHT] = new QAction(tr("Move Tab Right"), this);
-    seq = QKeySequence::fromString( settings.value(MOVE_RIGHT, MOVE_RIGHT_SHORTCUT).toString() );
-    Properties::Instance()->actions[MOVE_RIGHT]->setShortcut(seq);
-    connect(Properties::Instance()->actions[MOVE_RIGHT], SIGNAL(triggered()), consoleTabulator, SLOT(moveRight()));
-    menu_Actions->addAction(Properties::Instance()->actions[MOVE_RIGHT]);
-    addAction(Properties::Instance()->actions[MOVE_RIGHT]);
-
-    menu_Actions->addSeparator();
-
-    Properties::Instance()->actions[SPLIT_HORIZONTAL] = new QAction(tr("Split Terminal Horizontally"), this);
-    seq = QKeySequence::fromString( settings.value(SPLIT_HORIZONTAL).toString() );
-    Properties::Instance()->actions[SPLIT_HORIZONTAL]->setShortcut(seq);
-    connect(Properties::Instance()->actions[SPLIT_HORIZONTAL], SIGNAL(triggered()), consoleTabulator, SLOT(splitHorizontally()));
-    menu_Actions->addAction(Properties::Instance()->actions[SPLIT_HORIZONTAL]);
-    addAction(Properties::Instance()->actions[SPLIT_HORIZONTAL]);
-
-    Properties::Instance()->actions[SPLIT_VERTICAL] = new QAction(tr("Split Terminal Vertically"), this);
-    seq = QKeySequence::fromString( settings.value(SPLIT_VERTICAL).toString() );
-    Properties::Instance()->actions[SPLIT_VERTICAL]->setShortcut(seq);
-    connect(Properties::Instance()->actions[SPLIT_VERTICAL], SIGNAL(triggered()), consoleTabulator, SLOT(splitVertically()));
-    menu_Actions->addAction(Properties::Instance()->actions[SPLIT_VERTICAL]);
-    addAction(Properties::Instance()->actions[SPLIT_VERTICAL]);
-
-    Properties::Instance()->actions[SUB_COLLAPSE] = new QAction(tr("Collapse Subterminal"), this);
-    seq = QKeySequence::fromString( settings.value(SUB_COLLAPSE).toString() );
-    Properties::Instance()->actions[SUB_COLLAPSE]->setShortcut(seq);
-    connect(Properties::Instance()->actions[SUB_COLLAPSE], SIGNAL(triggered()), consoleTabulator, SLOT(splitCollapse()));
-    menu_Actions->addAction(Properties::Instance()->actions[SUB_COLLAPSE]);
-    addAction(Properties::Instance()->actions[SUB_COLLAPSE]);
-
-    Properties::Instance()->actions[SUB_NEXT] = new QAction(QIcon::fromTheme("go-up"), tr("Next Subterminal"), this);
-    seq = QKeySequence::fromString( settings.value(SUB_NEXT, SUB_NEXT_SHORTCUT).toString() );
-    Properties::Instance()->actions[SUB_NEXT]->setShortcut(seq);
-    connect(Properties::Instance()->actions[SUB_NEXT], SIGNAL(triggered()), consoleTabulator, SLOT(switchNextSubterminal()));
-    menu_Actions->addAction(Properties::Instance()->actions[SUB_NEXT]);
-    addAction(Properties::Instance()->actions[SUB_NEXT]);
-
-    Properties::Instance()->actions[SUB_PREV] = new QAction(QIcon::fromTheme("go-down"), tr("Previous Subterminal"), this);
-    seq = QKeySequence::fromString( settings.value(SUB_PREV, SUB_PREV_SHORTCUT).toString() );
-    Properties::Instance()->actions[SUB_PREV]->setShortcut(seq);
-    connect(Properties::Instance()->actions[SUB_PREV], SIGNAL(triggered()), consoleTabulator, SLOT(switchPrevSubterminal()));
-    menu_Actions->addAction(Properties::Instance()->actions[SUB_PREV]);
-    addAction(Properties::Instance()->actions[SUB_PREV]);
-
-    menu_Actions->addSeparator();
-
-    // Copy and Paste are only added to the table for the sake of bindings at the moment; there is no Edit menu, only a context menu.
-    Properties::Instance()->actions[COPY_SELECTION] = new QAction(QIcon::fromTheme("edit-copy"), tr("Copy Selection"), this);
-    seq = QKeySequence::fromString( settings.value(COPY_SELECTION, COPY_SELECTION_SHORTCUT).toString() );
-    Properties::Instance()->actions[COPY_SELECTION]->setShortcut(seq);
-    connect(Properties::Instance()->actions[COPY_SELECTION], SIGNAL(triggered()), consoleTabulator, SLOT(copySelection()));
-    menu_Edit->addAction(Properties::Instance()->actions[COPY_SELECTION]);
-    addAction(Properties::Instance()->actions[COPY_SELECTION]);
-
-    Properties::Instance()->actions[PASTE_CLIPBOARD] = new QAction(QIcon::fromTheme("edit-paste"), tr("Paste Clipboard"), this);
-    seq = QKeySequence::fromString( settings.value(PASTE_CLIPBOARD, PASTE_CLIPBOARD_SHORTCUT).toString() );
-    Properties::Instance()->actions[PASTE_CLIPBOARD]->setShortcut(seq);
-    connect(Properties::Instance()->actions[PASTE_CLIPBOARD], SIGNAL(triggered()), consoleTabulator, SLOT(pasteClipboard()));
-    menu_Edit->addAction(Properties::Instance()->actions[PASTE_CLIPBOARD]);
-    addAction(Properties::Instance()->actions[PASTE_CLIPBOARD]);
-
-    Properties::Instance()->actions[PASTE_SELECTION] = new QAction(QIcon::fromTheme("edit-paste"), tr("Paste Selection"), this);
-    seq = QKeySequence::fromString( settings.value(PASTE_SELECTION, PASTE_SELECTION_SHORTCUT).toString() );
-    Properties::Instance()->actions[PASTE_SELECTION]->setShortcut(seq);
-    connect(Properties::Instance()->actions[PASTE_SELECTION], SIGNAL(triggered()), consoleTabulator, SLOT(pasteSelection()));
-    menu_Edit->addAction(Properties::Instance()->actions[PASTE_SELECTION]);
-    addAction(Properties::Instance()->actions[PASTE_SELECTION]);
-
-    Properties::Instance()->actions[ZOOM_IN] = new QAction(QIcon::fromTheme("zoom-in"), tr("Zoom in"), this);
-    seq = QKeySequence::fromString( settings.value(ZOOM_IN, ZOOM_IN_SHORTCUT).toString() );
-    Properties::Instance()->actions[ZOOM_IN]->setShortcut(seq);
-    connect(Properties::Instance()->actions[ZOOM_IN], SIGNAL(triggered()), consoleTabulator, SLOT(zoomIn()));
-    menu_Edit->addAction(Properties::Instance()->actions[ZOOM_IN]);
-    addAction(Properties::Instance()->actions[ZOOM_IN]);
-
-    Properties::Instance()->actions[ZOOM_OUT] = new QAction(QIcon::fromTheme("zoom-out"), tr("Zoom out"), this);
-    seq = QKeySequence::fromString( settings.value(ZOOM_OUT, ZOOM_OUT_SHORTCUT).toString() );
-    Properties::Instance()->actions[ZOOM_OUT]->setShortcut(seq);
-    connect(Properties::Instance()->actions[ZOOM_OUT], SIGNAL(triggered()), consoleTabulator, SLOT(zoomOut()));
-    menu_Edit->addAction(Properties::Instance()->actions[ZOOM_OUT]);
-    addAction(Properties::Instance()->actions[ZOOM_OUT]);
-
-    Properties::Instance()->actions[ZOOM_RESET] = new QAction(QIcon::fromTheme("zoom-original"), tr("Zoom reset"), this);
-    seq = QKeySequence::fromString( settings.value(ZOOM_RESET, ZOOM_RESET_SHORTCUT).toString() );
-    Properties::Instance()->actions[ZOOM_RESET]->setShortcut(seq);
-    connect(Properties::Instance()->actions[ZOOM_RESET], SIGNAL(triggered()), consoleTabulator, SLOT(zoomReset()));
-    menu_Edit->addAction(Properties::Instance()->actions[ZOOM_RESET]);
-    addAction(Properties::Instance()->actions[ZOOM_RESET]);
-
-    menu_Actions->addSeparator();
-
-    Properties::Instance()->actions[FIND] = new QAction(QIcon::fromTheme("edit-find"), tr("Find..."), this);
-    seq = QKeySequence::fromString( settings.value(FIND, FIND_SHORTCUT).toString() );
-    Properties::Instance()->actions[FIND]->setShortcut(seq);
-    connect(Properties::Instance()->actions[FIND], SIGNAL(triggered()), this, SLOT(find()));
-    menu_Actions->addAction(Properties::Instance()->actions[FIND]);
-    addAction(Properties::Instance()->actions[FIND]);
-
-#if 0
-    act = new QAction(this);
-    act->setSeparator(true);
-
-    // TODO/FIXME: unimplemented for now
-    act = new QAction(tr("Save Session"), this);
-    // do not use sequences for this task - it collides with eg. mc shorcuts
-    // and mainly - it's not used too often
-    //act->setShortcut(QKeySequence::Save);
-    connect(act, SIGNAL(triggered()), consoleTabulator, SLOT(saveSession()));
-
-    act = new QAction(tr("Load Session"), this);
-    // do not use sequences for this task - it collides with eg. mc shorcuts
-    // and mainly - it's not used too often
-    //act->setShortcut(QKeySequence::Open);
-    connect(act, SIGNAL(triggered()), consoleTabulator, SLOT(loadSession()));
-#endif
-
-    Properties::Instance()->actions[TOGGLE_MENU] = new QAction(tr("Toggle Menu"), this);
-    seq = QKeySequence::fromString( settings.value(TOGGLE_MENU, TOGGLE_MENU_SHORTCUT).toString() );
-    Properties::Instance()->actions[TOGGLE_MENU]->setShortcut(seq);
-    connect(Properties::Instance()->actions[TOGGLE_MENU], SIGNAL(triggered()), this, SLOT(toggleMenu()));
-    addAction(Properties::Instance()->actions[TOGGLE_MENU]);
-    // tis is correct - add action to main window - not to menu to keep toggle working
-
-    settings.endGroup();
-
-    // apply props
-    propertiesChanged();
-}
-void MainWindow::setup_FileMenu_Actions()
-{
-    QSettings settings;
-    settings.beginGroup("Shortcuts");
-
-    QKeySequence seq;
-
-    Properties::Instance()->actions[ADD_TAB] = new QAction(QIcon::fromTheme("list-add"), tr("New Tab"), this);
-    seq = QKeySequence::fromString( settings.value(ADD_TAB, ADD_TAB_SHORTCUT).toString() );
-    Properties::Instance()->actions[ADD_TAB]->setShortcut(seq);
-    connect(Properties::Instance()->actions[ADD_TAB], SIGNAL(triggered()), this, SLOT(addNewTab()));
-    menu_File->addAction(Properties::Instance()->actions[ADD_TAB]);
-    addAction(Properties::Instance()->actions[ADD_TAB]);
-
-    QMenu *presetsMenu = new QMenu(tr("New Tab From Preset"), this);
-    presetsMenu->addAction(QIcon(), tr("1 Terminal"),
-                           consoleTabulator, SLOT(addNewTab()));
-    presetsMenu->addAction(QIcon(), tr("2 Horizontal Terminals"),
-                           consoleTabulator, SLOT(preset2Horizontal()));
-    presetsMenu->addAction(QIcon(), tr("2 Vertical Terminals"),
-                           consoleTabulator, SLOT(preset2Vertical()));
-    presetsMenu->addAction(QIcon(), tr("4 Terminals"),
-                           consoleTabulator, SLOT(preset4Terminals()));
-    menu_File->addMenu(presetsMenu);
-
-    Properties::Instance()->actions[CLOSE_TAB] = new QAction(QIcon::fromTheme("list-remove"), tr("Close Tab"), this);
-    seq = QKeySequence::fromString( settings.value(CLOSE_TAB, CLOSE_TAB_SHORTCUT).toString() );
-    Properties::Instance()->actions[CLOSE_TAB]->setShortcut(seq);
-    connect(Properties::Instance()->actions[CLOSE_TAB], SIGNAL(triggered()), consoleTabulator, SLOT(removeCurrentTab()));
-    menu_File->addAction(Properties::Instance()->actions[CLOSE_TAB]);
-    addAction(Properties::Instance()->actions[CLOSE_TAB]);
-
-    Properties::Instance()->actions[NEW_WINDOW] = new QAction(QIcon::fromTheme("window-new"), tr("New Window"), this);
-    seq = QKeySequence::fromString( settings.value(NEW_WINDOW, NEW_WINDOW_SHORTCUT).toString() );
-    Properties::Instance()->actions[NEW_WINDOW]->setShortcut(seq);
-    connect(Properties::Instance()->actions[NEW_WINDOW], SIGNAL(triggered()), this, SLOT(newTerminalWindow()));
-    menu_File->addAction(Properties::Instance()->actions[NEW_WINDOW]);
-    addAction(Properties::Instance()->actions[NEW_WINDOW]);
-
-    menu_File->addSeparator();
-
-    Properties::Instance()->actions[PREFERENCES] = actProperties;
-    seq = QKeySequence::fromString( settings.value(PREFERENCES).toString() );
-    Properties::Instance()->actions[PREFERENCES]->setShortcut(seq);
-    connect(actProperties, SIGNAL(triggered()), SLOT(actProperties_triggered()));
-    menu_File->addAction(Properties::Instance()->actions[PREFERENCES]);
-    addAction(Properties::Instance()->actions[PREFERENCES]);
-
-    menu_File->addSeparator();
-
-    Properties::Instance()->actions[QUIT] = actQuit;
-    seq = QKeySequence::fromString( settings.value(QUIT).toString() );
-    Properties::Instance()->actions[QUIT]->setShortcut(seq);
-    connect(actQuit, SIGNAL(triggered()), SLOT(close()));
-    menu_File->addAction(Properties::Instance()->actions[QUIT]);
-    addAction(Properties::Instance()->actions[QUIT]);
-
-    settings.endGroup();
-}
-
-void MainWindow::setup_ViewMenu_Actions()
-{
-    QKeySequence seq;
-    QSettings settings;
-    settings.beginGroup("Shortcuts");
-
-    QAction *hideBordersAction = new QAction(tr("Hide Window Borders"), this);
-    hideBordersAction->setCheckable(true);
-    hideBordersAction->setVisible(!m_dropMode);
-    seq = QKeySequence::fromString( settings.value(HIDE_WINDOW_BORDERS).toString() );
-    hideBordersAction->setShortcut(seq);
-    connect(hideBordersAction, SIGNAL(triggered()), this, SLOT(toggleBorderless()));
-    menu_Window->addAction(hideBordersAction);
-    Properties::Instance()->actions[HIDE_WINDOW_BORDERS] = hideBordersAction;
-    //Properties::Instance()->actions[HIDE_WINDOW_BORDERS]->setObjectName("toggle_Borderless");
+void MainWindow::setupActions()
+{
+    TraceSpan trace("MainWindow::setupActions");
+
+    // one connection for all actions - see actionTriggered()
+    m_actionGroup = new QActionGroup(this);
+    m_actionGroup->setExclusive(false);
+    connect(m_actionGroup, SIGNAL(triggered(QAction*)),
+            this, SLOT(actionTriggered(QAction*)));
+
+    m_actions.resize(ActionRegistry::ActionCount);
+    for (int i = 0; i < ActionRegistry::ActionCount; ++i)
+    {
+        QAction *act;
+        if (i == ActionRegistry::ToggleBookmarks)
+        {
+            act = m_bookmarksDock->toggleViewAction();
+        }
+        else
+        {
+            act = new QAction(ActionRegistry::icon(i), ActionRegistry::text(i), this);
+            act->setCheckable(ActionRegistry::descriptor(i).checkable);
+            act->setData(i);
+            m_actionGroup->addAction(act);
+        }
+        act->setShortcut(Properties::Instance()->shortcuts.value(i));
+        // add all actions to the window directly - menus are populated lazily
+        addAction(act);
+        m_actions[i] = act;
+    }
+
+    m_actions[ActionRegistry::HideWindowBorders]->setVisible(!m_dropMode);
 // TODO/FIXME: it's broken somehow. When I call toggleBorderless() here the non-responsive window appear
-//    Properties::Instance()->actions[HIDE_WINDOW_BORDERS]->setChecked(Properties::Instance()->borderless);
+//    m_actions[ActionRegistry::HideWindowBorders]->setChecked(Properties::Instance()->borderless);
 //    if (Properties::Instance()->borderless)
 //        toggleBorderless();
 
-    QAction *showTabBarAction = new QAction(tr("Show Tab Bar"), this);
-    //toggleTabbar->setObjectName("toggle_TabBar");
-    showTabBarAction->setCheckable(true);
-    showTabBarAction->setChecked(!Properties::Instance()->tabBarless);
-    seq = QKeySequence::fromString( settings.value(SHOW_TAB_BAR).toString() );
-    showTabBarAction->setShortcut(seq);
-    menu_Window->addAction(showTabBarAction);
-    Properties::Instance()->actions[SHOW_TAB_BAR] = showTabBarAction;
+    m_actions[ActionRegistry::ShowTabBar]->setChecked(!Properties::Instance()->tabBarless);
     toggleTabBar();
-    connect(showTabBarAction, SIGNAL(triggered()), this, SLOT(toggleTabBar()));
 
-    Properties::Instance()->actions[TOGGLE_BOOKMARKS] = m_bookmarksDock->toggleViewAction();
-    seq = QKeySequence::fromString( settings.value(TOGGLE_BOOKMARKS, TOGGLE_BOOKMARKS_SHORTCUT).toString() );
-    Properties::Instance()->actions[TOGGLE_BOOKMARKS]->setShortcut(seq);
-    menu_Window->addAction(Properties::Instance()->actions[TOGGLE_BOOKMARKS]);
-    settings.endGroup();
+    connect(menu_File, SIGNAL(aboutToShow()), this, SLOT(populateMenus()));
+    connect(menu_Actions, SIGNAL(aboutToShow()), this, SLOT(populateMenus()));
+    connect(menu_Edit, SIGNAL(aboutToShow()), this, SLOT(populateMenus()));
+    connect(menu_Window, SIGNAL(aboutToShow()), this, SLOT(populateMenus()));
+}
+
+void MainWindow::populateMenus()
+{
+    if (m_menusPopulated)
+        return;
+    m_menusPopulated = true;
+
+    QMenu *menus[ActionRegistry::MenuCount] = { 0, menu_File, menu_Actions, menu_Edit, menu_Window };
+
+    for (int i = 0; i < ActionRegistry::ActionCount; ++i)
+    {
+        const ActionRegistry::Descriptor & d = ActionRegistry::descriptor(i);
+        QMenu *menu = menus[d.menu];
+        if (!menu)
+            continue;
+
+        if (d.separator && !menu->isEmpty())
+            menu->addSeparator();
+        menu->addAction(m_actions.at(i));
+
+        if (i == ActionRegistry::AddTab)
+        {
+            QMenu *presetsMenu = new QMenu(tr("New Tab From Preset"), this);
+            presetsMenu->addAction(QIcon(), tr("1 Terminal"),
+                                   consoleTabulator, SLOT(addNewTab()));
+            presetsMenu->addAction(QIcon(), tr("2 Horizontal Terminals"),
+                                   consoleTabulator, SLOT(preset2Horizontal()));
+            presetsMenu->addAction(QIcon(), tr("2 Vertical Terminals"),
+                                   consoleTabulator, SLOT(preset2Vertical()));
+            presetsMenu->addAction(QIcon(), tr("4 Terminals"),
+                                   consoleTabulator, SLOT(preset4Terminals()));
+            menu_File->addMenu(presetsMenu);
+        }
+    }
 
     menu_Window->addSeparator();
 
@@ -452,14 +289,153 @@ void MainWindow::setup_ViewMenu_Actions()
     menu_Window->addMenu(scrollPosMenu);
 }
 
+void MainWindow::actionTriggered(QAction *action)
+{
+    switch (action->data().toInt())
+    {
+    case ActionRegistry::AddTab:
+        addNewTab();
+        break;
+    case ActionRegistry::CloseTab:
+        consoleTabulator->removeCurrentTab();
+        break;
+    case ActionRegistry::NewWindow:
+        newTerminalWindow();
+        break;
+    case ActionRegistry::SaveSession:
+        saveSession();
+        break;
+    case ActionRegistry::LoadSession:
+        loadSession();
+        break;
+    case ActionRegistry::Preferences:
+        actProperties_triggered();
+        break;
+    case ActionRegistry::Quit:
+        close();
+        break;
+    case ActionRegistry::ClearTerminal:
+        consoleTabulator->clearActiveTerminal();
+        break;
+    case ActionRegistry::TabNext:
+        consoleTabulator->switchToRight();
+        break;
+    case ActionRegistry::TabPrev:
+        consoleTabulator->switchToLeft();
+        break;
+    case ActionRegistry::MoveLeft:
+        consoleTabulator->moveLeft();
+        break;
+    case ActionRegistry::MoveRight:
+        consoleTabulator->moveRight();
+        break;
+    case ActionRegistry::SplitHorizontal:
+        consoleTabulator->splitHorizontally();
+        break;
+    case ActionRegistry::SplitVertical:
+        consoleTabulator->splitVertically();
+        break;
+    case ActionRegistry::SubCollapse:
+        consoleTabulator->splitCollapse();
+        break;
+    case ActionRegistry::SubNext:
+        consoleTabulator->switchNextSubterminal();
+        break;
+    case ActionRegistry::SubPrev:
+        consoleTabulator->switchPrevSubterminal();
+        break;
+    case ActionRegistry::SubLeft:
+        consoleTabulator->switchLeftSubterminal();
+        break;
+    case ActionRegistry::SubRight:
+        consoleTabulator->switchRightSubterminal();
+        break;
+    case ActionRegistry::SubUp:
+        consoleTabulator->switchUpperSubterminal();
+        break;
+    case ActionRegistry::SubDown:
+        consoleTabulator->switchLowerSubterminal();
+        break;
+    case ActionRegistry::SynchronizeInput:
+        consoleTabulator->setSynchronizeInput(action->isChecked());
+        break;
+    case ActionRegistry::Find:
+        find();
+        break;
+    case ActionRegistry::FindAll:
+        findInAllTabs();
+        break;
+    case ActionRegistry::CommandPalette:
+        showCommandPalette();
+        break;
+    case ActionRegistry::CopySelection:
+        consoleTabulator->copySelection();
+        break;
+    case ActionRegistry::PasteClipboard:
+        consoleTabulator->pasteClipboard();
+        break;
+    case ActionRegistry::PasteSelection:
+        consoleTabulator->pasteSelection();
+        break;
+    case ActionRegistry::ZoomIn:
+        consoleTabulator->zoomIn();
+        break;
+    case ActionRegistry::ZoomOut:
+        consoleTabulator->zoomOut();
+        break;
+    case ActionRegistry::ZoomReset:
+        consoleTabulator->zoomReset();
+        break;
+    case ActionRegistry::ToggleMenu:
+        toggleMenu();
+        break;
+    case ActionRegistry::HideWindowBorders:
+        toggleBorderless();
+        break;
+    case ActionRegistry::ShowTabBar:
+        toggleTabBar();
+        break;
+    case ActionRegistry::MemoryUsage:
+        showMemoryUsage();
+        break;
+    }
+}
+
+QAction *MainWindow::action(int id) const
+{
+    return m_actions.value(id);
+}
+
+QList<MainWindow*> MainWindow::windows()
+{
+    QList<MainWindow*> ret;
+    foreach (QWidget * w, QApplication::topLevelWidgets())
+    {
+        MainWindow * mw = qobject_cast<MainWindow*>(w);
+        // drop mode window has a hidden parent
+        if (!mw)
+            mw = w->findChild<MainWindow*>();
+        // a closed window may still wait for its deletion; the drop
+        // down is only hidden between uses
+        if (mw && (mw->isVisible() || mw->dropMode()) && !ret.contains(mw))
+            ret.append(mw);
+    }
+    return ret;
+}
+
 void MainWindow::on_consoleTabulator_currentChanged(int)
 {
+    // the first tab is added before the actions exist
+    QAction *sync = action(ActionRegistry::SynchronizeInput);
+    TermWidgetHolder *holder = consoleTabulator->terminalHolder();
+    if (sync)
+        sync->setChecked(holder && holder->synchronizeInput());
 }
 
 void MainWindow::toggleTabBar()
 {
     Properties::Instance()->tabBarless
-            = !Properties::Instance()->actions[SHOW_TAB_BAR]->isChecked();
+            = !m_actions[ActionRegistry::ShowTabBar]->isChecked();
     consoleTabulator->showHideTabBar();
 }
 
@@ -469,7 +445,7 @@ void MainWindow::toggleBorderless()
     show();
     setWindowState(Qt::WindowActive); /* don't loose focus on the window */
     Properties::Instance()->borderless
-            = Properties::Instance()->actions[HIDE_WINDOW_BORDERS]->isChecked(); realign();
+            = m_actions[ActionRegistry::HideWindowBorders]->isChecked(); realign();
 }
 
 void MainWindow::toggleMenu()
@@ -524,6 +500,92 @@ void MainWindow::closeEvent(QCloseEvent *ev)
     dia->deleteLater();
 }
 
+void MainWindow::showMemoryUsage()
+{
+    MemoryDialog *dia = new MemoryDialog(this);
+    dia->setAttribute(Qt::WA_DeleteOnClose);
+    dia->show();
+}
+
+void MainWindow::findInAllTabs()
+{
+    GlobalSearchDialog *dia = new GlobalSearchDialog(this);
+    dia->setAttribute(Qt::WA_DeleteOnClose);
+    dia->show();
+}
+
+void MainWindow::showCommandPalette()
+{
+    CommandPalette *dia = new CommandPalette(this);
+    dia->setAttribute(Qt::WA_DeleteOnClose);
+    connect(dia, SIGNAL(callCommand(QString)),
+            this, SLOT(bookmarksWidget_callCommand(QString)));
+    dia->show();
+}
+
+void MainWindow::saveSession()
+{
+    bool ok = false;
+    QString name = QInputDialog::getItem(this, tr("Save Session"), tr("Session name:"),
+                                         Properties::Instance()->sessions.keys(),
+                                         -1, true, &ok);
+    if (!ok || name.isEmpty())
+        return;
+
+    SessionState state;
+    foreach (MainWindow *mw, windows())
+    {
+        // the drop down window lives on its own
+        if (mw->dropMode())
+            continue;
+        SessionState::Window w;
+        w.geometry = mw->saveGeometry();
+        mw->consoleTabulator->saveTabs(w);
+        state.windows.append(w);
+    }
+    Properties::Instance()->sessions[name] = state.toString();
+    Properties::Instance()->saveSettings();
+}
+
+void MainWindow::loadSession()
+{
+    QStringList names = Properties::Instance()->sessions.keys();
+    if (names.isEmpty())
+    {
+        QMessageBox::information(this, tr("Load Session"), tr("There are no saved sessions."));
+        return;
+    }
+
+    bool ok = false;
+    QString name = QInputDialog::getItem(this, tr("Load Session"), tr("List of saved sessions:"),
+                                         names, 0, false, &ok);
+    if (!ok || name.isEmpty())
+        return;
+
+    SessionState state;
+    if (!state.fromString(Properties::Instance()->sessions.value(name)))
+    {
+        QMessageBox::warning(this, tr("Load Session"),
+                             tr("The session \"%1\" has been saved by another version of QTerminal or it is damaged.").arg(name));
+        return;
+    }
+
+    TraceSpan trace("MainWindow::loadSession");
+    foreach (const SessionState::Window &w, state.windows)
+    {
+        if (w.tabs.isEmpty())
+            continue;
+        s_restoring = true;
+        MainWindow *mw = new MainWindow(m_initWorkDir, m_initShell, false);
+        s_restoring = false;
+        // shells are started when their tabs are shown for the first time
+        mw->consoleTabulator->restoreTabs(w);
+        if (!w.geometry.isEmpty())
+            mw->restoreGeometry(w.geometry);
+        mw->show();
+    }
+}
+
 void MainWindow::actAbout_triggered()
 {
     QMessageBox::about(this, QString("QTerminal ") + STR_VERSION, tr("A lightweight multiplatform terminal emulator"));
@@ -532,31 +594,50 @@ void MainWindow::actAbout_triggered()
 void MainWindow::actProperties_triggered()
 {
     PropertiesDialog *p = new PropertiesDialog(this);
-    connect(p, SIGNAL(propertiesChanged()), this, SLOT(propertiesChanged()));
+    connect(p, SIGNAL(propertiesChanged()), Properties::Instance(), SLOT(notifyChanged()));
     p->exec();
 }
 
-void MainWindow::propertiesChanged()
+void MainWindow::propertiesChanged(Properties::Changes changes)
 {
-    QApplication::setStyle(Properties::Instance()->guiStyle);
-    setWindowOpacity(1.0 - Properties::Instance()->appTransparency/100.0);
-    consoleTabulator->setTabPosition((QTabWidget::TabPosition)Properties::Instance()->tabsPos);
-    consoleTabulator->propertiesChanged();
-    setDropShortcut(Properties::Instance()->dropShortCut);
-
-    m_menuBar->setVisible(Properties::Instance()->menuVisible);
+    // restyling repolishes every widget of the application - once, not
+    // for each window
+    QString style = Properties::Instance()->guiStyle;
+    if ((changes & Properties::GuiStyle) && !style.isEmpty()
+        && QApplication::style()->objectName().compare(style, Qt::CaseInsensitive) != 0)
+        QApplication::setStyle(style);
+
+    if (changes & Properties::WindowOptions)
+    {
+        setWindowOpacity(1.0 - Properties::Instance()->appTransparency/100.0);
+        consoleTabulator->setTabPosition((QTabWidget::TabPosition)Properties::Instance()->tabsPos);
+        setDropShortcut(Properties::Instance()->dropShortCut);
+        m_menuBar->setVisible(Properties::Instance()->menuVisible);
+    }
+    consoleTabulator->propertiesChanged(changes);
 
-    m_bookmarksDock->setVisible(Properties::Instance()->useBookmarks
-                                && Properties::Instance()->bookmarksVisible);
-    m_bookmarksDock->toggleViewAction()->setVisible(Properties::Instance()->useBookmarks);
+    if (changes & Properties::Shortcuts)
+    {
+        for (int i = 0; i < m_actions.count(); ++i)
+            m_actions.at(i)->setShortcut(Properties::Instance()->shortcuts.value(i));
+    }
 
-    if (Properties::Instance()->useBookmarks)
+    if (changes & Properties::Bookmarks)
     {
-        qobject_cast<BookmarksWidget*>(m_bookmarksDock->widget())->setup();
+        BookmarksWidget *bookmarksWidget = qobject_cast<BookmarksWidget*>(m_bookmarksDock->widget());
+        m_bookmarksDock->setVisible(Properties::Instance()->useBookmarks
+                                    && Properties::Instance()->bookmarksVisible);
+        m_bookmarksDock->toggleViewAction()->setVisible(Properties::Instance()->useBookmarks);
+
+        // refresh an already built dock only; see bookmarksDock_visibilityChanged()
+        if (Properties::Instance()->useBookmarks && bookmarksWidget)
+        {
+            bookmarksWidget->setup();
+        }
     }
 
-    Properties::Instance()->saveSettings();
-    realign();
+    if (changes & Properties::WindowOptions)
+        realign();
 }
 
 void MainWindow::realign()
@@ -644,6 +725,15 @@ void MainWindow::bookmarksWidget_callCommand(const QString& cmd)
 void MainWindow::bookmarksDock_visibilityChanged(bool visible)
 {
     Properties::Instance()->bookmarksVisible = visible;
+
+    if (visible && !m_bookmarksDock->widget())
+    {
+        BookmarksWidget *bookmarksWidget = new BookmarksWidget(m_bookmarksDock);
+        m_bookmarksDock->setWidget(bookmarksWidget);
+        connect(bookmarksWidget, SIGNAL(callCommand(QString)),
+                this, SLOT(bookmarksWidget_callCommand(QString)));
+        bookmarksWidget->setup();
+    }
 }
 
 void MainWindow::addNewTab()
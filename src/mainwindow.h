@@ -25,6 +25,8 @@
 
 #include <QMainWindow>
 #include "qxtglobalshortcut.h"
+#include "actionregistry.h"
+#include "properties.h"
 
 class QToolButton;
 
@@ -40,6 +42,12 @@ public:
 
     bool dropMode() { return m_dropMode; }
 
+    //! Window's instance of ActionRegistry::ActionId action
+    QAction *action(int id) const;
+
+    //! Open terminal windows of the process, including the drop down one
+    static QList<MainWindow*> windows();
+
 protected:
      bool event(QEvent* event);
 
@@ -54,9 +62,11 @@ private:
 
     QDockWidget *m_bookmarksDock;
 
-    void setup_FileMenu_Actions();
-    void setup_ActionsMenu_Actions();
-    void setup_ViewMenu_Actions();
+    QVector<QAction*> m_actions;
+    QActionGroup *m_actionGroup;
+    bool m_menusPopulated;
+
+    void setupActions();
 
     void closeEvent(QCloseEvent*);
 
@@ -69,9 +79,10 @@ private:
 
 private slots:
     void on_consoleTabulator_currentChanged(int);
-    void propertiesChanged();
+    void propertiesChanged(Properties::Changes changes = Properties::AllChanges);
     void actAbout_triggered();
     void actProperties_triggered();
+    void showMemoryUsage();
     void updateActionGroup(QAction *);
 
     void toggleBorderless();
@@ -81,11 +92,18 @@ private slots:
     void showHide();
     void setKeepOpen(bool value);
     void find();
+    void findInAllTabs();
+    void showCommandPalette();
+    void saveSession();
+    void loadSession();
 
     void newTerminalWindow();
     void bookmarksWidget_callCommand(const QString&);
     void bookmarksDock_visibilityChanged(bool visible);
 
     void addNewTab();
+
+    void populateMenus();
+    void actionTriggered(QAction *action);
 };
 #endif //MAINWINDOW_H
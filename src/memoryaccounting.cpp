@@ -0,0 +1,267 @@
+#include <QApplication>
+#include <QScrollBar>
+#include <QSocketNotifier>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <signal.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+#include "memoryaccounting.h"
+#include "mainwindow.h"
+#include "tabwidget.h"
+#include "termwidgetholder.h"
+#include "termwidget.h"
+#include "scrollbackarchive.h"
+
+
+/*! Konsole::Character - UTF-16 code, rendition, foreground and
+    background CharacterColor and flags.
+ */
+static const int CELL_BYTES = 12;
+//! 32 bit backing store
+static const int PIXEL_BYTES = 4;
+
+MemoryAccounting * MemoryAccounting::m_instance = 0;
+
+#ifdef Q_OS_UNIX
+static int s_signalFd[2] = { -1, -1 };
+
+static void usr1Handler(int)
+{
+    char c = 1;
+    ssize_t ret = ::write(s_signalFd[0], &c, sizeof(c));
+    Q_UNUSED(ret);
+}
+#endif
+
+
+static QString jsonEscape(const QString & str)
+{
+    QString s = str;
+    s.replace('\\', "\\\\");
+    s.replace('"', "\\\"");
+    return s;
+}
+
+static TabWidget * tabsOf(MainWindow * w)
+{
+    return w->findChild<TabWidget*>("consoleTabulator");
+}
+
+static QList<TermMemoryUsage> windowUsage(MainWindow * w)
+{
+    QList<TermMemoryUsage> ret;
+    TabWidget * tabs = tabsOf(w);
+    if (!tabs)
+        return ret;
+
+    for (int i = 0; i < tabs->count(); ++i)
+    {
+        TermWidgetHolder * holder = qobject_cast<TermWidgetHolder*>(tabs->widget(i));
+        if (!holder)
+            continue;
+        foreach (TermWidget * term, holder->terminals())
+        {
+            TermMemoryUsage u = MemoryAccounting::usage(term);
+            u.window = w;
+            u.tab = i;
+            u.holderId = holder->id();
+            u.tabLabel = tabs->tabText(i);
+            ret.append(u);
+        }
+    }
+    return ret;
+}
+
+
+MemoryAccounting * MemoryAccounting::Instance()
+{
+    if (!m_instance)
+        m_instance = new MemoryAccounting();
+    return m_instance;
+}
+
+MemoryAccounting::MemoryAccounting()
+    : QObject(0),
+      m_notifier(0)
+{
+}
+
+TermMemoryUsage MemoryAccounting::usage(TermWidget * term)
+{
+    TermMemoryUsage u;
+    u.term = term;
+    u.window = 0;
+    u.tab = -1;
+    u.holderId = -1;
+
+    QWidget * display = term->impl()->display();
+    if (!display)
+        display = term->impl();
+    QFontMetrics fm(display->font());
+    u.columns = qMax(1, display->width() / qMax(1, fm.width(QLatin1Char('M'))));
+    u.lines = qMax(1, display->height() / qMax(1, fm.height()));
+
+    // the scrollbar range is the number of history lines
+    QScrollBar * scrollBar = term->impl()->findChild<QScrollBar*>();
+    u.historyLines = scrollBar ? scrollBar->maximum() : 0;
+
+    u.scrollbackBytes = (qint64)u.historyLines * u.columns * CELL_BYTES;
+    if (term->impl()->archive())
+        u.scrollbackBytes += term->impl()->archive()->memoryBytes();
+    u.screenBytes = 3 * (qint64)u.lines * u.columns * CELL_BYTES;
+    u.widgetBytes = (qint64)display->width() * display->height() * PIXEL_BYTES;
+    return u;
+}
+
+QList<TermMemoryUsage> MemoryAccounting::usage()
+{
+    QList<TermMemoryUsage> ret;
+    foreach (MainWindow * w, MainWindow::windows())
+        ret += windowUsage(w);
+    return ret;
+}
+
+qint64 MemoryAccounting::tabUsage(TermWidgetHolder * holder)
+{
+    qint64 total = 0;
+    foreach (TermWidget * term, holder->terminals())
+        total += usage(term).total();
+    return total;
+}
+
+qint64 MemoryAccounting::residentKb()
+{
+#ifdef Q_OS_LINUX
+    // statm: size resident shared ... in pages
+    QFile f("/proc/self/statm");
+    if (f.open(QIODevice::ReadOnly))
+    {
+        QList<QByteArray> fields = f.readAll().split(' ');
+        if (fields.count() > 1)
+            return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) / 1024;
+    }
+#endif
+#ifdef Q_OS_UNIX
+    // peak only but better than nothing
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef Q_OS_MAC
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+QString MemoryAccounting::formatSize(qint64 bytes)
+{
+    if (bytes < 1024)
+        return QObject::tr("%1 B").arg(bytes);
+    if (bytes < 1024 * 1024)
+        return QObject::tr("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1);
+    if (bytes < 1024 * 1024 * 1024)
+        return QObject::tr("%1 MiB").arg(bytes / (1024.0 * 1024), 0, 'f', 1);
+    return QObject::tr("%1 GiB").arg(bytes / (1024.0 * 1024 * 1024), 0, 'f', 2);
+}
+
+QString MemoryAccounting::report()
+{
+    QString ret;
+    QTextStream out(&ret);
+    qint64 total = 0;
+
+    out << "{\"windows\":[\n";
+    QList<MainWindow*> list = MainWindow::windows();
+    for (int i = 0; i < list.count(); ++i)
+    {
+        QList<TermMemoryUsage> terms = windowUsage(list.at(i));
+        qint64 windowTotal = 0;
+
+        out << "{\"title\":\"" << jsonEscape(list.at(i)->windowTitle()) << "\",\"terminals\":[\n";
+        for (int j = 0; j < terms.count(); ++j)
+        {
+            const TermMemoryUsage & u = terms.at(j);
+            windowTotal += u.total();
+            out << "{\"tab\":" << u.tab << ","
+                << "\"label\":\"" << jsonEscape(u.tabLabel) << "\","
+                << "\"terminal\":\"" << jsonEscape(u.term ? u.term->impl()->objectName() : QString()) << "\","
+                << "\"columns\":" << u.columns << ","
+                << "\"lines\":" << u.lines << ","
+                << "\"history_lines\":" << u.historyLines << ","
+                << "\"scrollback_bytes\":" << u.scrollbackBytes << ","
+                << "\"screen_bytes\":" << u.screenBytes << ","
+                << "\"widget_bytes\":" << u.widgetBytes << ","
+                << "\"total_bytes\":" << u.total() << "}"
+                << (j < terms.count() - 1 ? ",\n" : "\n");
+        }
+        out << "],\"total_bytes\":" << windowTotal << "}"
+            << (i < list.count() - 1 ? ",\n" : "\n");
+        total += windowTotal;
+    }
+    out << "],\"terminals_total_bytes\":" << total << ","
+        << "\"rss_kb\":" << residentKb() << "}\n";
+    out.flush();
+    return ret;
+}
+
+void MemoryAccounting::setOutput(const QString & fname)
+{
+    m_output = fname;
+
+#ifdef Q_OS_UNIX
+    if (m_output.isEmpty() || m_notifier)
+        return;
+
+    // the Qt way of handling unix signals - see "Calling Qt Functions From Unix Signal Handlers"
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, s_signalFd) != 0)
+    {
+        qDebug() << "MemoryAccounting: cannot create socketpair for SIGUSR1";
+        return;
+    }
+    m_notifier = new QSocketNotifier(s_signalFd[1], QSocketNotifier::Read, this);
+    connect(m_notifier, SIGNAL(activated(int)), this, SLOT(signalReceived()));
+
+    struct sigaction usr1;
+    memset(&usr1, 0, sizeof(usr1));
+    usr1.sa_handler = usr1Handler;
+    sigemptyset(&usr1.sa_mask);
+    usr1.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &usr1, 0);
+#endif
+}
+
+void MemoryAccounting::writeOutput()
+{
+    if (m_output.isEmpty())
+        return;
+
+    QFile f(m_output);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        qDebug() << "MemoryAccounting: cannot write to" << m_output;
+        return;
+    }
+    f.write(report().toUtf8());
+    qDebug() << "MemoryAccounting: written to" << m_output;
+}
+
+void MemoryAccounting::signalReceived()
+{
+#ifdef Q_OS_UNIX
+    char c;
+    ssize_t ret = ::read(s_signalFd[1], &c, sizeof(c));
+    Q_UNUSED(ret);
+#endif
+    writeOutput();
+}
@@ -0,0 +1,88 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+
+class TermWidget;
+class TermWidgetHolder;
+class MainWindow;
+class QSocketNotifier;
+
+
+/*! \brief Memory used by one terminal.
+
+qtermwidget does not expose its buffers so the sizes are estimates
+from what is visible: the scrollbar range (history lines), the screen
+geometry in character cells and the widget area. Unlimited history is
+kept in temporary files by qtermwidget; it's counted the same way
+because it is mapped into memory when scrolled. An archived history
+(ScrollbackArchive) counts with its resident part only.
+*/
+struct TermMemoryUsage
+{
+    QPointer<TermWidget> term;
+    QPointer<MainWindow> window;
+    int tab;
+    //! TermWidgetHolder::id() - unlike tab it survives moving the tabs
+    int holderId;
+    QString tabLabel;
+
+    int columns;
+    int lines;
+    int historyLines;
+
+    qint64 scrollbackBytes;
+    //! primary and alternate screen plus the display's image
+    qint64 screenBytes;
+    //! backing store share and the display's pixmap caches
+    qint64 widgetBytes;
+
+    qint64 total() const { return scrollbackBytes + screenBytes + widgetBytes; }
+};
+
+
+/*! \brief Per-terminal, per-window and process memory report.
+
+usage() walks all windows on demand - there is no bookkeeping cost
+while nobody asks. report() is the same as JSON; it's written to the
+--memory-report file on exit and whenever SIGUSR1 arrives.
+*/
+class MemoryAccounting : public QObject
+{
+    Q_OBJECT
+
+    public:
+        static MemoryAccounting * Instance();
+
+        static TermMemoryUsage usage(TermWidget * term);
+        //! All terminals of all windows
+        static QList<TermMemoryUsage> usage();
+        //! Sum of the terminals of one tab
+        static qint64 tabUsage(TermWidgetHolder * holder);
+
+        //! Resident set size of the process in kB, 0 if unknown
+        static qint64 residentKb();
+        static QString formatSize(qint64 bytes);
+
+        static QString report();
+
+        /*! Write report() to \a fname on exit (see writeOutput()) and
+            on SIGUSR1. Empty name disables it.
+         */
+        void setOutput(const QString & fname);
+        void writeOutput();
+
+    private:
+        MemoryAccounting();
+
+        static MemoryAccounting * m_instance;
+        QString m_output;
+        QSocketNotifier * m_notifier;
+
+    private slots:
+        void signalReceived();
+};
+
+#endif
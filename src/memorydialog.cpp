@@ -0,0 +1,146 @@
+#include <QFileDialog>
+#include <QFile>
+
+#include "memorydialog.h"
+#include "mainwindow.h"
+#include "tabwidget.h"
+#include "termwidget.h"
+#include "termwidgetholder.h"
+
+
+enum Columns {
+    WindowColumn = 0,
+    TabColumn,
+    HistoryColumn,
+    ScrollbackColumn,
+    ScreenColumn,
+    WidgetColumn,
+    TotalColumn
+};
+
+//! index into MemoryDialog::m_usage
+static const int UsageRole = Qt::UserRole + 1;
+
+
+//! Sorts by the raw numbers, not by the formatted sizes
+class MemoryItem : public QTreeWidgetItem
+{
+public:
+    MemoryItem(QTreeWidget *parent) : QTreeWidgetItem(parent) {}
+
+    void setNumber(int column, qint64 value, const QString & text)
+    {
+        setData(column, Qt::UserRole, value);
+        setText(column, text);
+        setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+    }
+
+    bool operator<(const QTreeWidgetItem & other) const
+    {
+        int column = treeWidget() ? treeWidget()->sortColumn() : 0;
+        QVariant a = data(column, Qt::UserRole);
+        if (a.isValid())
+            return a.toLongLong() < other.data(column, Qt::UserRole).toLongLong();
+        return QTreeWidgetItem::operator<(other);
+    }
+};
+
+
+MemoryDialog::MemoryDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setupUi(this);
+
+    connect(refreshButton, SIGNAL(clicked()), this, SLOT(refresh()));
+    connect(clearButton, SIGNAL(clicked()), this, SLOT(clearTerminal()));
+    connect(saveButton, SIGNAL(clicked()), this, SLOT(saveReport()));
+    connect(memoryTree, SIGNAL(itemDoubleClicked(QTreeWidgetItem*,int)),
+            this, SLOT(activateTerminal(QTreeWidgetItem*)));
+
+    refresh();
+    memoryTree->sortByColumn(TotalColumn, Qt::DescendingOrder);
+}
+
+void MemoryDialog::refresh()
+{
+    m_usage = MemoryAccounting::usage();
+
+    memoryTree->setSortingEnabled(false);
+    memoryTree->clear();
+
+    qint64 total = 0;
+    for (int i = 0; i < m_usage.count(); ++i)
+    {
+        const TermMemoryUsage & u = m_usage.at(i);
+        total += u.total();
+
+        MemoryItem *item = new MemoryItem(memoryTree);
+        item->setText(WindowColumn, u.window ? u.window->windowTitle() : QString());
+        item->setText(TabColumn, u.tabLabel);
+        item->setData(WindowColumn, UsageRole, i);
+        item->setNumber(HistoryColumn, u.historyLines, QString::number(u.historyLines));
+        item->setNumber(ScrollbackColumn, u.scrollbackBytes, MemoryAccounting::formatSize(u.scrollbackBytes));
+        item->setNumber(ScreenColumn, u.screenBytes, MemoryAccounting::formatSize(u.screenBytes));
+        item->setNumber(WidgetColumn, u.widgetBytes, MemoryAccounting::formatSize(u.widgetBytes));
+        item->setNumber(TotalColumn, u.total(), MemoryAccounting::formatSize(u.total()));
+    }
+
+    memoryTree->setSortingEnabled(true);
+    for (int i = 0; i < memoryTree->columnCount(); ++i)
+        memoryTree->resizeColumnToContents(i);
+
+    totalLabel->setText(tr("%n terminal(s): %1, process resident size: %2", "", m_usage.count())
+                        .arg(MemoryAccounting::formatSize(total))
+                        .arg(MemoryAccounting::formatSize(MemoryAccounting::residentKb() * 1024)));
+}
+
+TermMemoryUsage * MemoryDialog::selectedUsage()
+{
+    QTreeWidgetItem *item = memoryTree->currentItem();
+    if (!item)
+        return 0;
+    int i = item->data(WindowColumn, UsageRole).toInt();
+    if (i < 0 || i >= m_usage.count() || !m_usage.at(i).term)
+        return 0;
+    return &m_usage[i];
+}
+
+void MemoryDialog::clearTerminal()
+{
+    TermMemoryUsage *u = selectedUsage();
+    if (!u)
+        return;
+    // drops the scrollback too
+    u->term->impl()->clear();
+    refresh();
+}
+
+void MemoryDialog::saveReport()
+{
+    QString fname = QFileDialog::getSaveFileName(this, tr("Save Memory Report"),
+                                                 QString("qterminal-memory.json"),
+                                                 tr("JSON files (*.json)"));
+    if (fname.isEmpty())
+        return;
+
+    QFile f(fname);
+    if (f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        f.write(MemoryAccounting::report().toUtf8());
+}
+
+void MemoryDialog::activateTerminal(QTreeWidgetItem *item)
+{
+    memoryTree->setCurrentItem(item);
+    TermMemoryUsage *u = selectedUsage();
+    if (!u || !u->window || !u->term)
+        return;
+
+    u->window->show();
+    u->window->raise();
+    u->window->activateWindow();
+    TabWidget *tabs = u->window->findChild<TabWidget*>("consoleTabulator");
+    TermWidgetHolder *holder = tabs ? tabs->holder(u->holderId) : 0;
+    if (holder)
+        tabs->setCurrentIndex(tabs->indexOf(holder));
+    u->term->setFocus();
+}
@@ -0,0 +1,31 @@
+#ifndef MEMORYDIALOG_H
+#define MEMORYDIALOG_H
+
+#include "ui_memorydialog.h"
+#include "memoryaccounting.h"
+
+
+/*! \brief "Memory Usage" view.
+
+Lists all terminals of all windows with their estimated memory usage.
+The columns sort numerically so the biggest terminals can be found and
+cleared. Double click brings the terminal to front.
+*/
+class MemoryDialog : public QDialog, public Ui::MemoryDialog
+{
+    Q_OBJECT
+public:
+    MemoryDialog(QWidget *parent = 0);
+
+private:
+    QList<TermMemoryUsage> m_usage;
+    TermMemoryUsage * selectedUsage();
+
+private slots:
+    void refresh();
+    void clearTerminal();
+    void saveReport();
+    void activateTerminal(QTreeWidgetItem *item);
+};
+
+#endif
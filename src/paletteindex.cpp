@@ -0,0 +1,185 @@
+#include "paletteindex.h"
+#include "actionregistry.h"
+#include "bookmarkswidget.h"
+#include "mainwindow.h"
+#include "tabwidget.h"
+#include "termwidget.h"
+#include "termwidgetholder.h"
+
+
+PaletteIndex * PaletteIndex::m_instance = 0;
+
+
+static PaletteEntry entry(PaletteEntry::Kind kind, const QString & text, const QString & detail, int id = -1)
+{
+    PaletteEntry e;
+    e.kind = kind;
+    e.text = text;
+    e.detail = detail;
+    e.key = (text + ' ' + detail).toLower();
+    e.id = id;
+    return e;
+}
+
+
+PaletteIndex * PaletteIndex::Instance()
+{
+    if (!m_instance)
+        m_instance = new PaletteIndex();
+    return m_instance;
+}
+
+PaletteIndex::PaletteIndex()
+    : QObject(0),
+      m_dirty(true),
+      m_generation(0),
+      m_bookmarks(new BookmarksModel(this))
+{
+    connect(m_bookmarks, SIGNAL(modelReset()), this, SLOT(bookmarksLoaded()));
+    connect(Properties::Instance(), SIGNAL(changed(Properties::Changes)),
+            this, SLOT(propertiesChanged(Properties::Changes)));
+
+    buildActions();
+    if (Properties::Instance()->useBookmarks)
+        m_bookmarks->setup();
+}
+
+const QVector<PaletteEntry> & PaletteIndex::entries()
+{
+    if (m_dirty)
+    {
+        m_entries.clear();
+        for (int i = 0; i < SectionCount; ++i)
+            m_entries += m_sections[i];
+        m_dirty = false;
+    }
+    return m_entries;
+}
+
+void PaletteIndex::setSection(Section section, const QVector<PaletteEntry> & entries)
+{
+    m_sections[section] = entries;
+    m_dirty = true;
+    ++m_generation;
+    emit changed();
+}
+
+void PaletteIndex::buildActions()
+{
+    QVector<PaletteEntry> entries;
+    for (int i = 0; i < ActionRegistry::ActionCount; ++i)
+    {
+        QString text = ActionRegistry::text(i).remove('&');
+        QString shortcut = Properties::Instance()->shortcuts.value(i).toString(QKeySequence::NativeText);
+        entries.append(entry(PaletteEntry::Action, text, shortcut, i));
+    }
+    setSection(ActionSection, entries);
+}
+
+void PaletteIndex::refreshPanes()
+{
+    QVector<PaletteEntry> entries;
+    foreach (MainWindow * w, MainWindow::windows())
+    {
+        TabWidget * tabs = w->findChild<TabWidget*>("consoleTabulator");
+        if (!tabs)
+            continue;
+        for (int i = 0; i < tabs->count(); ++i)
+        {
+            TermWidgetHolder * holder = qobject_cast<TermWidgetHolder*>(tabs->widget(i));
+            if (!holder)
+                continue;
+
+            QList<TermWidget*> terms = holder->terminals();
+            if (terms.isEmpty())
+            {
+                // deferred - it is started when it is brought to front
+                PaletteEntry e = entry(PaletteEntry::Pane, tabs->tabText(i), QString(), holder->id());
+                e.window = w;
+                entries.append(e);
+                continue;
+            }
+
+            for (int j = 0; j < terms.count(); ++j)
+            {
+                TermWidgetImpl * impl = terms.at(j)->impl();
+                QString text = terms.count() == 1 ? tabs->tabText(i)
+                                                  : tr("%1 (pane %2)").arg(tabs->tabText(i)).arg(j + 1);
+                QString detail = impl->workingDirectory();
+                if (!impl->command().isEmpty())
+                    detail += "  " + impl->command();
+
+                PaletteEntry e = entry(PaletteEntry::Pane, text, detail, holder->id());
+                e.window = w;
+                e.term = terms.at(j);
+                entries.append(e);
+            }
+        }
+    }
+    setSection(PaneSection, entries);
+}
+
+void PaletteIndex::addBookmarks(const QModelIndex & parent, QVector<PaletteEntry> & entries)
+{
+    for (int i = 0; i < m_bookmarks->rowCount(parent); ++i)
+    {
+        QModelIndex index = m_bookmarks->index(i, 0, parent);
+        if (m_bookmarks->rowCount(index) > 0)
+        {
+            addBookmarks(index, entries);
+            continue;
+        }
+        // groups have no command
+        QString command = m_bookmarks->index(i, 1, parent).data().toString();
+        if (!command.isEmpty())
+            entries.append(entry(PaletteEntry::Bookmark, index.data().toString(), command));
+    }
+}
+
+void PaletteIndex::bookmarksLoaded()
+{
+    QVector<PaletteEntry> entries;
+    addBookmarks(QModelIndex(), entries);
+    setSection(BookmarkSection, entries);
+}
+
+void PaletteIndex::propertiesChanged(Properties::Changes changes)
+{
+    if (changes & Properties::Shortcuts)
+        buildActions();
+    if (changes & Properties::Bookmarks)
+    {
+        if (Properties::Instance()->useBookmarks)
+            m_bookmarks->setup();
+        else
+            setSection(BookmarkSection, QVector<PaletteEntry>());
+    }
+}
+
+int PaletteIndex::score(const QString & key, const QString & query)
+{
+    const QChar * k = key.constData();
+    const int length = key.length();
+    int ret = 0;
+    int pos = 0;
+    int last = -2;
+
+    for (int i = 0; i < query.length(); ++i)
+    {
+        const QChar c = query.at(i);
+        while (pos < length && k[pos] != c)
+            ++pos;
+        if (pos == length)
+            return -1;
+
+        if (pos == last + 1)
+            ret += 4;
+        else if (pos == 0 || !k[pos - 1].isLetterOrNumber())
+            ret += 3;
+        else
+            ret += 1;
+        last = pos++;
+    }
+    // of equal matches the one ending earlier wins - the text is before the details
+    return ret * 8 - qMin(last, 7);
+}
@@ -0,0 +1,98 @@
+#ifndef PALETTEINDEX_H
+#define PALETTEINDEX_H
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include <QModelIndex>
+
+#include "properties.h"
+
+class MainWindow;
+class TermWidget;
+class BookmarksModel;
+
+
+//! One thing the CommandPalette can go to or run
+struct PaletteEntry
+{
+    enum Kind {
+        Action = 0,
+        Pane,
+        Bookmark
+    };
+
+    Kind kind;
+    QString text;
+    //! shortcut, working directory and command or the bookmark's command
+    QString detail;
+    //! text and detail in lower case - the query is matched against it
+    QString key;
+    //! ActionRegistry::ActionId or TermWidgetHolder::id()
+    int id;
+    QPointer<MainWindow> window;
+    //! 0 for a tab which has not been materialized yet
+    QPointer<TermWidget> term;
+};
+
+
+/*! \brief Searchable list of actions, panes and bookmarks of all windows.
+
+The entries are kept per section and only the changed section is built
+again: the actions when the shortcuts change, the bookmarks when their
+file is loaded (in a BookmarksLoader thread) and the panes on
+refreshPanes(). The keys are lower case in advance so a query is matched
+without any allocation - see score().
+*/
+class PaletteIndex : public QObject
+{
+    Q_OBJECT
+
+    public:
+        static PaletteIndex * Instance();
+
+        //! Read the tabs and panes of all windows again
+        void refreshPanes();
+
+        //! All sections in one list. Indices are valid for one generation()
+        const QVector<PaletteEntry> & entries();
+        int generation() const { return m_generation; }
+
+        /*! How well \a query (lower case) matches \a key: all its characters
+            in order, better when they are adjacent or start words.
+            -1 when it does not match at all.
+         */
+        static int score(const QString & key, const QString & query);
+
+    signals:
+        //! entries() and generation() have changed
+        void changed();
+
+    private:
+        enum Section {
+            ActionSection = 0,
+            PaneSection,
+            BookmarkSection,
+            SectionCount
+        };
+
+        PaletteIndex();
+        static PaletteIndex * m_instance;
+
+        QVector<PaletteEntry> m_sections[SectionCount];
+        QVector<PaletteEntry> m_entries;
+        bool m_dirty;
+        int m_generation;
+        //! private copy, the docks of the windows are built only when shown
+        BookmarksModel * m_bookmarks;
+
+        void setSection(Section section, const QVector<PaletteEntry> & entries);
+        void buildActions();
+        void addBookmarks(const QModelIndex & parent, QVector<PaletteEntry> & entries);
+
+    private slots:
+        void propertiesChanged(Properties::Changes changes);
+        void bookmarksLoaded();
+};
+
+#endif
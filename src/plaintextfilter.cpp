@@ -0,0 +1,84 @@
+#include "plaintextfilter.h"
+
+
+PlainTextFilter::PlainTextFilter()
+    : m_carriageReturn(false),
+      m_escape(Text)
+{
+}
+
+void PlainTextFilter::reset()
+{
+    m_partial.clear();
+    m_carriageReturn = false;
+    m_escape = Text;
+}
+
+void PlainTextFilter::filter(const QString & data, QStringList & lines)
+{
+    for (int i = 0; i < data.length(); ++i)
+    {
+        QChar c = data.at(i);
+        ushort u = c.unicode();
+
+        switch (m_escape)
+        {
+        case Escape:
+            if (u == '[')
+                m_escape = Csi;
+            else if (u == ']')
+                m_escape = Osc;
+            else
+                m_escape = Text;
+            continue;
+        case Csi:
+            // parameters and intermediates up to the final byte
+            if (u >= 0x40 && u <= 0x7e)
+                m_escape = Text;
+            continue;
+        case Osc:
+            // title and friends end with BEL or ST
+            if (u == 0x07)
+                m_escape = Text;
+            else if (u == 0x1b)
+                m_escape = OscEscape;
+            continue;
+        case OscEscape:
+            m_escape = (u == '\\') ? Text : Osc;
+            continue;
+        case Text:
+            break;
+        }
+
+        switch (u)
+        {
+        case 0x1b:
+            m_escape = Escape;
+            break;
+        case '\n':
+            lines.append(m_partial);
+            m_partial.clear();
+            m_carriageReturn = false;
+            break;
+        case '\r':
+            // progress bars - the next text overwrites the line
+            m_carriageReturn = true;
+            break;
+        case '\b':
+            m_partial.chop(1);
+            break;
+        case '\t':
+            m_partial.append(c);
+            break;
+        default:
+            if (u < 0x20 || u == 0x7f)
+                break;
+            if (m_carriageReturn)
+            {
+                m_partial.clear();
+                m_carriageReturn = false;
+            }
+            m_partial.append(c);
+        }
+    }
+}
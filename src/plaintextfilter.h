@@ -0,0 +1,43 @@
+#ifndef PLAINTEXTFILTER_H
+#define PLAINTEXTFILTER_H
+
+#include <QString>
+#include <QStringList>
+
+
+/*! \brief Reduces terminal output to plain text lines.
+
+Escape sequences (CSI, OSC and the two byte ones) and control
+characters are dropped, backspace removes the previous character and
+text after a carriage return overwrites the line - enough for shells,
+compilers and progress bars. Full screen programs come out garbled;
+they are not line oriented anyway.
+
+The output may be split anywhere, even inside an escape sequence.
+*/
+class PlainTextFilter
+{
+    public:
+        PlainTextFilter();
+
+        //! Append the lines completed by \a data to \a lines
+        void filter(const QString & data, QStringList & lines);
+        //! The incomplete last line
+        QString pending() const { return m_partial; }
+        void reset();
+
+    private:
+        enum EscapeState {
+            Text,
+            Escape,
+            Csi,
+            Osc,
+            OscEscape
+        };
+
+        QString m_partial;
+        bool m_carriageReturn;
+        EscapeState m_escape;
+};
+
+#endif
@@ -1,12 +1,129 @@
 #include <qtermwidget.h>
 
+#ifdef Q_OS_UNIX
+#include <stdio.h>
+#endif
+
 #include "properties.h"
+#include "actionregistry.h"
 #include "config.h"
+#include "startuptrace.h"
 
 
 Properties * Properties::m_instance = 0;
 
 
+/*! Applies the changed keys to the settings file off the GUI thread.
+    The file is updated in a copy which then replaces the original
+    so other processes never see it half written.
+ */
+class SettingsWriter : public QThread
+{
+public:
+    SettingsWriter(const QString &fname, QObject *parent)
+        : QThread(parent),
+          m_fname(fname)
+    {
+    }
+
+    void setChanges(const QMap<QString,QVariant> &changed, const QStringList &removed)
+    {
+        m_changed = changed;
+        m_removed = removed;
+    }
+
+    //! Md5 of the file as written by the last run()
+    QByteArray writtenHash() const { return m_hash; }
+
+protected:
+    void run()
+    {
+        QString tmpName = m_fname + ".tmp";
+        QFile::remove(tmpName);
+        if (QFile::exists(m_fname) && !QFile::copy(m_fname, tmpName))
+        {
+            qDebug() << "SettingsWriter: cannot copy" << m_fname << "to" << tmpName;
+            return;
+        }
+
+        {
+            QSettings settings(tmpName, QSettings::IniFormat);
+            foreach (QString key, m_removed)
+                settings.remove(key);
+            QMap<QString,QVariant>::const_iterator it = m_changed.constBegin();
+            while (it != m_changed.constEnd())
+            {
+                settings.setValue(it.key(), it.value());
+                ++it;
+            }
+            settings.sync();
+            if (settings.status() != QSettings::NoError)
+            {
+                qDebug() << "SettingsWriter: cannot write" << tmpName;
+                QFile::remove(tmpName);
+                return;
+            }
+        }
+
+#ifdef Q_OS_UNIX
+        if (::rename(QFile::encodeName(tmpName).constData(), QFile::encodeName(m_fname).constData()) != 0)
+#else
+        QFile::remove(m_fname);
+        if (!QFile::rename(tmpName, m_fname))
+#endif
+        {
+            qDebug() << "SettingsWriter: cannot replace" << m_fname;
+            QFile::remove(tmpName);
+            return;
+        }
+
+        QFile f(m_fname);
+        if (f.open(QIODevice::ReadOnly))
+            m_hash = QCryptographicHash::hash(f.readAll(), QCryptographicHash::Md5);
+    }
+
+private:
+    QString m_fname;
+    QMap<QString,QVariant> m_changed;
+    QStringList m_removed;
+    QByteArray m_hash;
+};
+
+
+SettingsSnapshot::SettingsSnapshot()
+    : d(new SettingsSnapshotData)
+{
+}
+
+SettingsSnapshot::SettingsSnapshot(QSettings & settings)
+    : d(new SettingsSnapshotData)
+{
+    foreach (QString key, settings.allKeys())
+        d->values[key] = settings.value(key);
+}
+
+QVariant SettingsSnapshot::value(const QString & key, const QVariant & defaultValue) const
+{
+    return d->values.value(key, defaultValue);
+}
+
+SettingsSnapshot::SettingsSnapshot(const QMap<QString,QVariant> & values)
+    : d(new SettingsSnapshotData)
+{
+    d->values = values;
+}
+
+bool SettingsSnapshot::contains(const QString & key) const
+{
+    return d->values.contains(key);
+}
+
+bool SettingsSnapshot::operator==(const SettingsSnapshot & other) const
+{
+    return d == other.d || d->values == other.d->values;
+}
+
+
 Properties * Properties::Instance(const QString& filename)
 {
     if (!m_instance)
@@ -14,19 +131,31 @@ Properties * Properties::Instance(const QString& filename)
     return m_instance;
 }
 
-Properties::Properties(const QString& filename) : filename(filename)
+Properties::Properties(const QString& filename)
+    : filename(filename),
+      m_savePending(false)
 {
     if (filename.isEmpty()) {
         QSettings settings;
         this->filename = settings.fileName();
     }
     qDebug("Properties constructor called");
+
+    m_reloadTimer.setSingleShot(true);
+    connect(&m_reloadTimer, SIGNAL(timeout()), this, SLOT(reloadSettings()));
+    connect(&m_watcher, SIGNAL(fileChanged(QString)), this, SLOT(settingsFileChanged()));
+
+    m_saveTimer.setSingleShot(true);
+    connect(&m_saveTimer, SIGNAL(timeout()), this, SLOT(flushSettings()));
+
+    m_writer = new SettingsWriter(this->filename, this);
+    connect(m_writer, SIGNAL(finished()), this, SLOT(writerFinished()));
 }
 
 Properties::~Properties()
 {
     qDebug("Properties destructor called");
-    saveSettings();
+    syncSettings();
     delete m_instance;
     m_instance = 0;
 }
@@ -42,11 +171,19 @@ QFont Properties::defaultFont()
 
 void Properties::loadSettings()
 {
+    TraceSpan trace("Properties::loadSettings");
     QSettings settings(filename, QSettings::IniFormat);
+    m_snapshot = SettingsSnapshot(settings);
+    applySnapshot(m_snapshot);
+    markSaved();
+    m_published = storedValues();
+    watchSettingsFile();
+}
 
+void Properties::applySnapshot(const SettingsSnapshot & settings)
+{
+    // applied by MainWindow::propertiesChanged() when it has been changed
     guiStyle = settings.value("guiStyle", QString()).toString();
-    if (!guiStyle.isNull())
-        QApplication::setStyle(guiStyle);
 
     colorScheme = settings.value("colorScheme", "Linux").toString();
 
@@ -54,35 +191,49 @@ void Properties::loadSettings()
 
     font = qvariant_cast<QFont>(settings.value("font", defaultFont()));
 
-    settings.beginGroup("Shortcuts");
-    QStringList keys = settings.childKeys();
-    foreach( QString key, keys )
+    // shortcuts - defaults are in ActionRegistry
+    shortcuts.resize(ActionRegistry::ActionCount);
+    for (int i = 0; i < ActionRegistry::ActionCount; ++i)
     {
-        QKeySequence sequence = QKeySequence( settings.value( key ).toString() );
-        if( Properties::Instance()->actions.contains( key ) )
-            Properties::Instance()->actions[ key ]->setShortcut( sequence );
+        QString key = QString("Shortcuts/") + ActionRegistry::descriptor(i).name;
+        if (settings.contains(key))
+            shortcuts[i] = QKeySequence(settings.value(key).toString());
+        else
+            shortcuts[i] = ActionRegistry::defaultShortcut(i);
     }
-    settings.endGroup();
 
     mainWindowGeometry = settings.value("MainWindow/geometry").toByteArray();
     mainWindowState = settings.value("MainWindow/state").toByteArray();
 
     historyLimited = settings.value("HistoryLimited", true).toBool();
     historyLimitedTo = settings.value("HistoryLimitedTo", 1000).toUInt();
+    scrollbackBudget = settings.value("ScrollbackBudget", 0).toInt();
+    archiveHistory = settings.value("ArchiveHistory", false).toBool();
+    archiveRecentLines = settings.value("ArchiveRecentLines", 5000).toUInt();
+    throttleHiddenTerminals = settings.value("ThrottleHiddenTerminals", true).toBool();
+
+    monitorActivity = settings.value("MonitorActivity", false).toBool();
+    monitorSilence = settings.value("MonitorSilence", 0).toInt();
+    monitorFinished = settings.value("MonitorFinished", false).toBool();
+
+    sessionLogMode = settings.value("SessionLog/Mode", 0).toInt();
+    sessionLogDirectory = settings.value("SessionLog/Directory", QDir::homePath() + "/qterminal-logs").toString();
+    sessionLogCompress = settings.value("SessionLog/Compress", false).toBool();
+    sessionLogRotateSize = settings.value("SessionLog/RotateSize", 100).toInt();
+    sessionLogRotateHours = settings.value("SessionLog/RotateHours", 0).toInt();
 
     emulation = settings.value("emulation", "default").toString();
 
-    // sessions
-    int size = settings.beginReadArray("Sessions");
-    for (int i = 0; i < size; ++i)
+    // sessions. QSettings arrays are 1-based.
+    sessions.clear();
+    int size = settings.value("Sessions/size", 0).toInt();
+    for (int i = 1; i <= size; ++i)
     {
-        settings.setArrayIndex(i);
-        QString name(settings.value("name").toString());
+        QString name(settings.value(QString("Sessions/%1/name").arg(i)).toString());
         if (name.isEmpty())
             continue;
-        sessions[name] = settings.value("state").toByteArray();
+        sessions[name] = settings.value(QString("Sessions/%1/state").arg(i)).toByteArray();
     }
-    settings.endArray();
 
     appTransparency = settings.value("MainWindow/ApplicationTransparency", 0).toInt();
     termTransparency = settings.value("TerminalTransparency", 0).toInt();
@@ -100,95 +251,296 @@ void Properties::loadSettings()
     menuVisible = settings.value("MenuVisible", true).toBool();
     askOnExit = settings.value("AskOnExit", true).toBool();
     useCWD = settings.value("UseCWD", false).toBool();
+    singleInstance = settings.value("SingleInstance", false).toBool();
 
     // bookmarks
     useBookmarks = settings.value("UseBookmarks", false).toBool();
     bookmarksVisible = settings.value("BookmarksVisible", true).toBool();
-    bookmarksFile = settings.value("BookmarksFile", QFileInfo(settings.fileName()).canonicalPath()+"/qterminal_bookmarks.xml").toString();
+    bookmarksFile = settings.value("BookmarksFile", QFileInfo(filename).canonicalPath()+"/qterminal_bookmarks.xml").toString();
 
     terminalsPreset = settings.value("TerminalsPreset", 0).toInt();
+    terminalPoolSize = settings.value("TerminalPoolSize", 0).toInt();
 
-    settings.beginGroup("DropMode");
-    dropShortCut = QKeySequence(settings.value("ShortCut", "F12").toString());
-    dropKeepOpen = settings.value("KeepOpen", false).toBool();
-    dropShowOnStart = settings.value("ShowOnStart", true).toBool();
-    dropWidht = settings.value("Width", 70).toInt();
-    dropHeight = settings.value("Height", 45).toInt();
-    settings.endGroup();
+    dropShortCut = QKeySequence(settings.value("DropMode/ShortCut", "F12").toString());
+    dropKeepOpen = settings.value("DropMode/KeepOpen", false).toBool();
+    dropShowOnStart = settings.value("DropMode/ShowOnStart", true).toBool();
+    dropWidht = settings.value("DropMode/Width", 70).toInt();
+    dropHeight = settings.value("DropMode/Height", 45).toInt();
 }
 
-void Properties::saveSettings()
+void Properties::watchSettingsFile()
+{
+    // QSettings replaces the file on write so the watch has to be renewed
+    if (QFile::exists(filename) && !m_watcher.files().contains(filename))
+        m_watcher.addPath(filename);
+}
+
+void Properties::settingsFileChanged()
+{
+    // writers tend to touch the file more than once - wait for the last one
+    m_reloadTimer.start(100);
+}
+
+void Properties::reloadSettings()
 {
+    watchSettingsFile();
+
+    // a write of ours is still in flight; look again when it's done
+    if (m_saveTimer.isActive() || m_writer->isRunning())
+    {
+        m_reloadTimer.start(100);
+        return;
+    }
+
+    QFile f(filename);
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+    QByteArray hash = QCryptographicHash::hash(f.readAll(), QCryptographicHash::Md5);
+    f.close();
+    // the watcher reports our own rename too
+    if (hash == m_writtenHash)
+        return;
+
     QSettings settings(filename, QSettings::IniFormat);
+    SettingsSnapshot s(settings);
+    // an unrelated touch
+    if (s == m_snapshot)
+        return;
+
+    qDebug() << "Properties: settings file changed, reloading" << filename;
+    m_snapshot = s;
+    applySnapshot(m_snapshot);
+    markSaved();
+    notifyChanged();
+}
 
-    settings.setValue("guiStyle", guiStyle);
-    settings.setValue("colorScheme", colorScheme);
-    settings.setValue("highlightCurrentTerminal", highlightCurrentTerminal);
-    settings.setValue("font", font);
+QMap<QString,QVariant> Properties::storedValues() const
+{
+    QMap<QString,QVariant> values;
+
+    values["guiStyle"] = guiStyle;
+    values["colorScheme"] = colorScheme;
+    values["highlightCurrentTerminal"] = highlightCurrentTerminal;
+    values["font"] = font;
 
-    settings.beginGroup("Shortcuts");
-    QMapIterator< QString, QAction * > it(actions);
-    while( it.hasNext() )
+    for (int i = 0; i < shortcuts.count(); ++i)
     {
-        it.next();
-        QKeySequence shortcut = it.value()->shortcut();
-        settings.setValue( it.key(), shortcut.toString() );
+        values[QString("Shortcuts/") + ActionRegistry::descriptor(i).name] = shortcuts.at(i).toString();
     }
-    settings.endGroup();
 
-    settings.setValue("MainWindow/geometry", mainWindowGeometry);
-    settings.setValue("MainWindow/state", mainWindowState);
+    values["MainWindow/geometry"] = mainWindowGeometry;
+    values["MainWindow/state"] = mainWindowState;
+
+    values["HistoryLimited"] = historyLimited;
+    values["HistoryLimitedTo"] = historyLimitedTo;
+    values["ScrollbackBudget"] = scrollbackBudget;
+    values["ArchiveHistory"] = archiveHistory;
+    values["ArchiveRecentLines"] = archiveRecentLines;
+    values["ThrottleHiddenTerminals"] = throttleHiddenTerminals;
+
+    values["MonitorActivity"] = monitorActivity;
+    values["MonitorSilence"] = monitorSilence;
+    values["MonitorFinished"] = monitorFinished;
 
-    settings.setValue("HistoryLimited", historyLimited);
-    settings.setValue("HistoryLimitedTo", historyLimitedTo);
+    values["SessionLog/Mode"] = sessionLogMode;
+    values["SessionLog/Directory"] = sessionLogDirectory;
+    values["SessionLog/Compress"] = sessionLogCompress;
+    values["SessionLog/RotateSize"] = sessionLogRotateSize;
+    values["SessionLog/RotateHours"] = sessionLogRotateHours;
 
-    settings.setValue("emulation", emulation);
+    values["emulation"] = emulation;
 
-    // sessions
-    settings.beginWriteArray("Sessions");
+    // sessions - same layout as QSettings::beginWriteArray()
     int i = 0;
-    Sessions::iterator sit = sessions.begin();
-    while (sit != sessions.end())
+    Sessions::const_iterator sit = sessions.constBegin();
+    while (sit != sessions.constEnd())
     {
-        settings.setArrayIndex(i);
-        settings.setValue("name", sit.key());
-        settings.setValue("state", sit.value());
-        ++sit;
         ++i;
+        values[QString("Sessions/%1/name").arg(i)] = sit.key();
+        values[QString("Sessions/%1/state").arg(i)] = sit.value();
+        ++sit;
     }
-    settings.endArray();
-
-    settings.setValue("MainWindow/ApplicationTransparency", appTransparency);
-    settings.setValue("TerminalTransparency", termTransparency);
-    settings.setValue("ScrollbarPosition", scrollBarPos);
-    settings.setValue("TabsPosition", tabsPos);
-    settings.setValue("HideTabBarWithOneTab", hideTabBarWithOneTab);
-    settings.setValue("MotionAfterPaste", m_motionAfterPaste);
-    settings.setValue("Borderless", borderless);
-    settings.setValue("TabBarless", tabBarless);
-    settings.setValue("MenuVisible", menuVisible);
-    settings.setValue("AskOnExit", askOnExit);
-    settings.setValue("UseCWD", useCWD);
+    values["Sessions/size"] = i;
+
+    values["MainWindow/ApplicationTransparency"] = appTransparency;
+    values["TerminalTransparency"] = termTransparency;
+    values["ScrollbarPosition"] = scrollBarPos;
+    values["TabsPosition"] = tabsPos;
+    values["HideTabBarWithOneTab"] = hideTabBarWithOneTab;
+    values["MotionAfterPaste"] = m_motionAfterPaste;
+    values["Borderless"] = borderless;
+    values["TabBarless"] = tabBarless;
+    values["MenuVisible"] = menuVisible;
+    values["AskOnExit"] = askOnExit;
+    values["UseCWD"] = useCWD;
+    values["SingleInstance"] = singleInstance;
 
     // bookmarks
-    settings.setValue("UseBookmarks", useBookmarks);
-    settings.setValue("BookmarksVisible", bookmarksVisible);
-    settings.setValue("BookmarksFile", bookmarksFile);
+    values["UseBookmarks"] = useBookmarks;
+    values["BookmarksVisible"] = bookmarksVisible;
+    values["BookmarksFile"] = bookmarksFile;
 
-    settings.setValue("TerminalsPreset", terminalsPreset);
+    values["TerminalsPreset"] = terminalsPreset;
+    values["TerminalPoolSize"] = terminalPoolSize;
 
-    settings.beginGroup("DropMode");
-    settings.setValue("ShortCut", dropShortCut.toString());
-    settings.setValue("KeepOpen", dropKeepOpen);
-    settings.setValue("ShowOnStart", dropShowOnStart);
-    settings.setValue("Width", dropWidht);
-    settings.setValue("Height", dropHeight);
-    settings.endGroup();
+    values["DropMode/ShortCut"] = dropShortCut.toString();
+    values["DropMode/KeepOpen"] = dropKeepOpen;
+    values["DropMode/ShowOnStart"] = dropShowOnStart;
+    values["DropMode/Width"] = dropWidht;
+    values["DropMode/Height"] = dropHeight;
+
+    return values;
+}
+
+void Properties::markSaved()
+{
+    // Values read from the file are on the disk already. The defaults of
+    // missing keys are not - they'll be written by the next save.
+    QMap<QString,QVariant> values = storedValues();
+    m_saved.clear();
+    QMap<QString,QVariant>::const_iterator it = values.constBegin();
+    while (it != values.constEnd())
+    {
+        if (m_snapshot.contains(it.key()))
+            m_saved[it.key()] = it.value();
+        ++it;
+    }
+}
+
+Properties::Change Properties::changeForKey(const QString & key)
+{
+    if (key == "guiStyle")
+        return GuiStyle;
+    if (key == "colorScheme")
+        return ColorScheme;
+    if (key == "font")
+        return TerminalFont;
+    if (key == "HistoryLimited" || key == "HistoryLimitedTo" || key == "ScrollbackBudget"
+        || key == "ArchiveHistory" || key == "ArchiveRecentLines")
+        return History;
+    if (key == "emulation")
+        return Emulation;
+    if (key == "TerminalTransparency")
+        return TerminalTransparency;
+    if (key == "ScrollbarPosition")
+        return ScrollBarPosition;
+    if (key == "MotionAfterPaste")
+        return MotionAfterPaste;
+    if (key == "highlightCurrentTerminal")
+        return HighlightCurrentTerminal;
+    if (key.startsWith("Shortcuts/"))
+        return Shortcuts;
+    if (key.startsWith("SessionLog/"))
+        return SessionLogging;
+    if (key == "UseBookmarks" || key == "BookmarksVisible" || key == "BookmarksFile")
+        return Bookmarks;
+    // nobody applies these on the fly
+    if (key.startsWith("Sessions/") || key.startsWith("MainWindow/geometry")
+        || key.startsWith("MainWindow/state"))
+        return NoChange;
+    return WindowOptions;
+}
+
+void Properties::notifyChanged()
+{
+    QMap<QString,QVariant> values = storedValues();
+    Changes changes = NoChange;
+
+    QMap<QString,QVariant>::const_iterator it = values.constBegin();
+    while (it != values.constEnd())
+    {
+        if (m_published.value(it.key()) != it.value())
+            changes |= changeForKey(it.key());
+        ++it;
+    }
+    foreach (QString key, m_published.keys())
+    {
+        if (!values.contains(key))
+            changes |= changeForKey(key);
+    }
+    m_published = values;
+
+    if (changes == NoChange)
+        return;
+
+    emit changed(changes);
+}
 
+void Properties::saveSettings()
+{
+    // coalesce bursts (eg. closing several windows at once)
+    m_saveTimer.start(300);
+}
+
+void Properties::syncSettings()
+{
+    m_saveTimer.stop();
+    m_savePending = false;
+    m_writer->wait();
+    flushSettings();
+    m_writer->wait();
+    m_writtenHash = m_writer->writtenHash();
+}
+
+void Properties::flushSettings()
+{
+    if (m_writer->isRunning())
+    {
+        m_savePending = true;
+        return;
+    }
+
+    QMap<QString,QVariant> values = storedValues();
+    QMap<QString,QVariant> changed;
+    QStringList removed;
+
+    QMap<QString,QVariant>::const_iterator it = values.constBegin();
+    while (it != values.constEnd())
+    {
+        QMap<QString,QVariant>::const_iterator saved = m_saved.constFind(it.key());
+        if (saved == m_saved.constEnd() || saved.value() != it.value())
+            changed[it.key()] = it.value();
+        ++it;
+    }
+    // eg. shrunk sessions array
+    foreach (QString key, m_saved.keys())
+    {
+        if (!values.contains(key))
+            removed.append(key);
+    }
+
+    if (changed.isEmpty() && removed.isEmpty())
+        return;
+
+    qDebug() << "Properties: saving" << changed.keys() << "removing" << removed;
+
+    QMap<QString,QVariant> disk = m_snapshot.toMap();
+    foreach (QString key, removed)
+        disk.remove(key);
+    for (it = changed.constBegin(); it != changed.constEnd(); ++it)
+        disk[it.key()] = it.value();
+    m_snapshot = SettingsSnapshot(disk);
+    m_saved = values;
+
+    m_writer->setChanges(changed, removed);
+    m_writer->start();
+}
+
+void Properties::writerFinished()
+{
+    m_writtenHash = m_writer->writtenHash();
+    watchSettingsFile();
+
+    if (m_savePending)
+    {
+        m_savePending = false;
+        flushSettings();
+    }
 }
 
 void Properties::migrate_settings()
 {
+    TraceSpan trace("Properties::migrate_settings");
     // Deal with rearrangements of settings.
     // If this method becomes unbearably huge we should look at the config-update
     // system used by kde and razor.
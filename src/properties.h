@@ -13,16 +13,87 @@ typedef QMap<QString,Session> Sessions;
 typedef QMap<QString,QString> ShortcutMap;
 
 
-class Properties
+class SettingsSnapshotData : public QSharedData
 {
     public:
+        QMap<QString,QVariant> values;
+};
+
+/*! \brief Immutable, implicitly shared copy of the settings file.
+
+It's parsed once per file change and shared by everything in the process.
+Keys are flat QSettings keys, eg. "DropMode/Width" or "Sessions/1/name".
+*/
+class SettingsSnapshot
+{
+    public:
+        SettingsSnapshot();
+        explicit SettingsSnapshot(QSettings & settings);
+        explicit SettingsSnapshot(const QMap<QString,QVariant> & values);
+
+        QVariant value(const QString & key, const QVariant & defaultValue = QVariant()) const;
+        bool contains(const QString & key) const;
+        QMap<QString,QVariant> toMap() const { return d->values; }
+
+        bool operator==(const SettingsSnapshot & other) const;
+        bool operator!=(const SettingsSnapshot & other) const { return !(*this == other); }
+
+    private:
+        QSharedDataPointer<SettingsSnapshotData> d;
+};
+
+
+class SettingsWriter;
+
+class Properties : public QObject
+{
+    Q_OBJECT
+
+    public:
+        /*! What has been changed since the last changed() signal. Receivers
+            apply only these - a terminal rebuilds its font only when
+            the font has really been changed.
+         */
+        enum Change {
+            NoChange                 = 0x0000,
+            GuiStyle                 = 0x0001,
+            ColorScheme              = 0x0002,
+            TerminalFont             = 0x0004,
+            History                  = 0x0008,
+            Emulation                = 0x0010,
+            TerminalTransparency     = 0x0020,
+            ScrollBarPosition        = 0x0040,
+            MotionAfterPaste         = 0x0080,
+            HighlightCurrentTerminal = 0x0100,
+            Shortcuts                = 0x0200,
+            Bookmarks                = 0x0400,
+            //! anything else handled by MainWindow/TabWidget
+            WindowOptions            = 0x0800,
+            SessionLogging           = 0x1000,
+
+            TerminalChanges = ColorScheme | TerminalFont | History | Emulation
+                              | TerminalTransparency | ScrollBarPosition
+                              | MotionAfterPaste | HighlightCurrentTerminal
+                              | SessionLogging,
+            AllChanges = 0x1fff
+        };
+        Q_DECLARE_FLAGS(Changes, Change)
+
         static Properties *Instance(const QString& filename = QString(""));
 
         QFont defaultFont();
+        /*! Schedule writing of the changed values. The file is updated
+            shortly after in a background thread; see syncSettings().
+         */
         void saveSettings();
+        //! Write pending changes now and wait for it
+        void syncSettings();
         void loadSettings();
         void migrate_settings();
 
+        //! The settings file as it was last read or written
+        SettingsSnapshot snapshot() const { return m_snapshot; }
+
         QByteArray mainWindowGeometry;
         QByteArray mainWindowState;
         //ShortcutMap shortcuts;
@@ -34,6 +105,30 @@ class Properties
 
         bool historyLimited;
         unsigned historyLimitedTo;
+        //! total history lines of all terminals, 0 = off. See ScrollbackBudget
+        int scrollbackBudget;
+        //! searchable copy of the output, see ScrollbackArchive
+        bool archiveHistory;
+        //! lines the terminal keeps itself with unlimited history and
+        //! the archive on - the rest is in the archive only. 0 = all
+        unsigned archiveRecentLines;
+        //! see RenderThrottle
+        bool throttleHiddenTerminals;
+
+        //! tab indicators, see ActivityMonitor
+        bool monitorActivity;
+        //! seconds, 0 = off
+        int monitorSilence;
+        bool monitorFinished;
+
+        //! SessionLog::Mode
+        int sessionLogMode;
+        QString sessionLogDirectory;
+        bool sessionLogCompress;
+        //! MB, 0 = never
+        int sessionLogRotateSize;
+        //! hours, 0 = never
+        int sessionLogRotateHours;
 
         QString emulation;
 
@@ -55,11 +150,14 @@ class Properties
 
         bool useCWD;
 
+        bool singleInstance;
+
         bool useBookmarks;
         bool bookmarksVisible;
         QString bookmarksFile;
 
         int terminalsPreset;
+        int terminalPoolSize;
 
         QKeySequence dropShortCut;
         bool dropKeepOpen;
@@ -67,9 +165,22 @@ class Properties
         int dropWidht;
         int dropHeight;
 
-        QMap< QString, QAction * > actions;
+        //! current shortcuts, indexed by ActionRegistry::ActionId
+        QVector<QKeySequence> shortcuts;
+
+
 
+    public slots:
+        /*! Tell everybody about the modified values. It does nothing
+            when nothing has been changed since the last call.
+         */
+        void notifyChanged();
 
+    signals:
+        /*! Emitted when the values have been changed - by PropertiesDialog
+            or by another process writing the settings file.
+         */
+        void changed(Properties::Changes changes);
 
     private:
 
@@ -77,11 +188,37 @@ class Properties
         static Properties *m_instance;
         QString filename;
 
+        SettingsSnapshot m_snapshot;
+        QFileSystemWatcher m_watcher;
+        QTimer m_reloadTimer;
+
+        //! values as they are in the file, see storedValues()
+        QMap<QString,QVariant> m_saved;
+        QTimer m_saveTimer;
+        SettingsWriter *m_writer;
+        bool m_savePending;
+        QByteArray m_writtenHash;
+        //! values as they were at the last changed() signal
+        QMap<QString,QVariant> m_published;
+
         explicit Properties(const QString& filename);
-        Properties(const Properties &) {};
+        Q_DISABLE_COPY(Properties)
         ~Properties();
 
+        void applySnapshot(const SettingsSnapshot & s);
+        void watchSettingsFile();
+        QMap<QString,QVariant> storedValues() const;
+        void markSaved();
+        static Change changeForKey(const QString & key);
+
+    private slots:
+        void settingsFileChanged();
+        void reloadSettings();
+        void flushSettings();
+        void writerFinished();
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(Properties::Changes)
+
 #endif
 
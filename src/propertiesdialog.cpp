@@ -6,8 +6,10 @@
 
 #include "propertiesdialog.h"
 #include "properties.h"
+#include "actionregistry.h"
 #include "fontdialog.h"
 #include "config.h"
+#include "sessionlog.h"
 
 
 PropertiesDialog::PropertiesDialog(QWidget *parent)
@@ -84,9 +86,23 @@ PropertiesDialog::PropertiesDialog(QWidget *parent)
 
     useCwdCheckBox->setChecked(Properties::Instance()->useCWD);
 
+    singleInstanceCheckBox->setChecked(Properties::Instance()->singleInstance);
+    terminalPoolSpinBox->setValue(Properties::Instance()->terminalPoolSize);
+
     historyLimited->setChecked(Properties::Instance()->historyLimited);
     historyUnlimited->setChecked(!Properties::Instance()->historyLimited);
     historyLimitedTo->setValue(Properties::Instance()->historyLimitedTo);
+    scrollbackBudgetSpinBox->setValue(Properties::Instance()->scrollbackBudget);
+    archiveHistoryCheckBox->setChecked(Properties::Instance()->archiveHistory);
+    archiveRecentSpinBox->setValue(Properties::Instance()->archiveRecentLines);
+    archiveRecentSpinBox->setEnabled(Properties::Instance()->archiveHistory);
+    connect(archiveHistoryCheckBox, SIGNAL(toggled(bool)),
+            archiveRecentSpinBox, SLOT(setEnabled(bool)));
+    throttleHiddenCheckBox->setChecked(Properties::Instance()->throttleHiddenTerminals);
+
+    monitorActivityCheckBox->setChecked(Properties::Instance()->monitorActivity);
+    monitorSilenceSpinBox->setValue(Properties::Instance()->monitorSilence);
+    monitorFinishedCheckBox->setChecked(Properties::Instance()->monitorFinished);
 
     dropShowOnStartCheckBox->setChecked(Properties::Instance()->dropShowOnStart);
     dropHeightSpinBox->setValue(Properties::Instance()->dropHeight);
@@ -100,6 +116,18 @@ PropertiesDialog::PropertiesDialog(QWidget *parent)
             this, SLOT(bookmarksButton_clicked()));
 
     terminalPresetComboBox->setCurrentIndex(Properties::Instance()->terminalsPreset);
+
+    /* session logging, in SessionLog::Mode order */
+    QStringList logModes;
+    logModes << tr("Off") << tr("Plain text") << tr("Raw output with escape sequences");
+    sessionLogModeComboBox->addItems(logModes);
+    sessionLogModeComboBox->setCurrentIndex(Properties::Instance()->sessionLogMode);
+    sessionLogDirectoryLineEdit->setText(Properties::Instance()->sessionLogDirectory);
+    sessionLogCompressCheckBox->setChecked(Properties::Instance()->sessionLogCompress);
+    sessionLogRotateSizeSpinBox->setValue(Properties::Instance()->sessionLogRotateSize);
+    sessionLogRotateHoursSpinBox->setValue(Properties::Instance()->sessionLogRotateHours);
+    connect(sessionLogDirectoryButton, SIGNAL(clicked()),
+            this, SLOT(sessionLogDirectoryButton_clicked()));
 }
 
 
@@ -135,6 +163,9 @@ void PropertiesDialog::apply()
 
     Properties::Instance()->useCWD = useCwdCheckBox->isChecked();
 
+    Properties::Instance()->singleInstance = singleInstanceCheckBox->isChecked();
+    Properties::Instance()->terminalPoolSize = terminalPoolSpinBox->value();
+
     Properties::Instance()->scrollBarPos = scrollBarPos_comboBox->currentIndex();
     Properties::Instance()->tabsPos = tabsPos_comboBox->currentIndex();
     Properties::Instance()->hideTabBarWithOneTab = hideTabBarCheckBox->isChecked();
@@ -143,10 +174,16 @@ void PropertiesDialog::apply()
 
     Properties::Instance()->historyLimited = historyLimited->isChecked();
     Properties::Instance()->historyLimitedTo = historyLimitedTo->value();
+    Properties::Instance()->scrollbackBudget = scrollbackBudgetSpinBox->value();
+    Properties::Instance()->archiveHistory = archiveHistoryCheckBox->isChecked();
+    Properties::Instance()->archiveRecentLines = archiveRecentSpinBox->value();
+    Properties::Instance()->throttleHiddenTerminals = throttleHiddenCheckBox->isChecked();
 
-    saveShortcuts();
+    Properties::Instance()->monitorActivity = monitorActivityCheckBox->isChecked();
+    Properties::Instance()->monitorSilence = monitorSilenceSpinBox->value();
+    Properties::Instance()->monitorFinished = monitorFinishedCheckBox->isChecked();
 
-    Properties::Instance()->saveSettings();
+    saveShortcuts();
 
     Properties::Instance()->dropShowOnStart = dropShowOnStartCheckBox->isChecked();
     Properties::Instance()->dropHeight = dropHeightSpinBox->value();
@@ -159,6 +196,14 @@ void PropertiesDialog::apply()
 
     Properties::Instance()->terminalsPreset = terminalPresetComboBox->currentIndex();
 
+    Properties::Instance()->sessionLogMode = sessionLogModeComboBox->currentIndex();
+    Properties::Instance()->sessionLogDirectory = sessionLogDirectoryLineEdit->text();
+    Properties::Instance()->sessionLogCompress = sessionLogCompressCheckBox->isChecked();
+    Properties::Instance()->sessionLogRotateSize = sessionLogRotateSizeSpinBox->value();
+    Properties::Instance()->sessionLogRotateHours = sessionLogRotateHoursSpinBox->value();
+
+    Properties::Instance()->saveSettings();
+
     emit propertiesChanged();
 }
 
@@ -181,45 +226,37 @@ void PropertiesDialog::changeFontButton_clicked()
 
 void PropertiesDialog::saveShortcuts()
 {
-    QList< QString > shortcutKeys = Properties::Instance()->actions.keys();
-    int shortcutCount = shortcutKeys.count();
-
-    shortcutsWidget->setRowCount( shortcutCount );
-
-    for( int x=0; x < shortcutCount; x++ )
+    for( int x=0; x < shortcutsWidget->rowCount(); x++ )
     {
-        QString keyValue = shortcutKeys.at(x);
-        QAction *keyAction = Properties::Instance()->actions[keyValue];
-
+        // rows can be sorted - ActionId is stored in the name item
+        int id = shortcutsWidget->item(x, 0)->data(Qt::UserRole).toInt();
         QTableWidgetItem *item = shortcutsWidget->item(x, 1);
-        QKeySequence sequence = QKeySequence(item->text());
-        QString sequenceString = sequence.toString();
-
-        keyAction->setShortcut(sequenceString);
+        Properties::Instance()->shortcuts[id] = QKeySequence(item->text());
     }
 }
 
 void PropertiesDialog::setupShortcuts()
 {
-    QList< QString > shortcutKeys = Properties::Instance()->actions.keys();
-    int shortcutCount = shortcutKeys.count();
+    int shortcutCount = Properties::Instance()->shortcuts.count();
 
+    shortcutsWidget->setSortingEnabled(false);
     shortcutsWidget->setRowCount( shortcutCount );
 
     for( int x=0; x < shortcutCount; x++ )
     {
-        QString keyValue = shortcutKeys.at(x);
-        QAction *keyAction = Properties::Instance()->actions[keyValue];
+        QString keyValue = ActionRegistry::descriptor(x).name;
 
         QTableWidgetItem *itemName = new QTableWidgetItem( tr(keyValue.toStdString().c_str()) );
-        QTableWidgetItem *itemShortcut = new QTableWidgetItem( keyAction->shortcut().toString() );
+        QTableWidgetItem *itemShortcut = new QTableWidgetItem( Properties::Instance()->shortcuts.at(x).toString() );
 
         itemName->setFlags( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
+        itemName->setData( Qt::UserRole, x );
 
         shortcutsWidget->setItem(x, 0, itemName);
         shortcutsWidget->setItem(x, 1, itemShortcut);
     }
 
+    shortcutsWidget->setSortingEnabled(true);
     shortcutsWidget->resizeColumnsToContents();
 /*
     connect(shortcutsWidget, SIGNAL(currentChanged(int, int)),
@@ -261,6 +298,14 @@ void PropertiesDialog::bookmarksButton_clicked()
     openBookmarksFile(bookmarksLineEdit->text());
 }
 
+void PropertiesDialog::sessionLogDirectoryButton_clicked()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Log directory"),
+                                                    sessionLogDirectoryLineEdit->text());
+    if (!dir.isEmpty())
+        sessionLogDirectoryLineEdit->setText(dir);
+}
+
 void PropertiesDialog::openBookmarksFile(const QString &fname)
 {
     QFile f(fname);
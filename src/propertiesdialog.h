@@ -27,6 +27,7 @@ class PropertiesDialog : public QDialog, Ui::PropertiesDialog
         
         void changeFontButton_clicked();
         void bookmarksButton_clicked();
+        void sessionLogDirectoryButton_clicked();
 
     protected:
         void setupShortcuts();
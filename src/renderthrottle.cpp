@@ -0,0 +1,146 @@
+#include <QEvent>
+
+#include "renderthrottle.h"
+#include "termwidget.h"
+
+
+RenderThrottle * RenderThrottle::m_instance = 0;
+
+
+RenderThrottle * RenderThrottle::Instance()
+{
+    if (!m_instance)
+        m_instance = new RenderThrottle();
+    return m_instance;
+}
+
+RenderThrottle::RenderThrottle()
+    : QObject(0)
+{
+    connect(Properties::Instance(), SIGNAL(changed(Properties::Changes)),
+            this, SLOT(propertiesChanged(Properties::Changes)));
+}
+
+bool RenderThrottle::isEnabled() const
+{
+    return Properties::Instance()->throttleHiddenTerminals;
+}
+
+void RenderThrottle::addTerminal(TermWidgetImpl * term)
+{
+    QWidget * display = term->display();
+    if (!display)
+        return;
+
+    m_displays[term] = display;
+    display->installEventFilter(this);
+    // new terminals are created hidden (pool, deferred tabs)
+    update(term);
+}
+
+void RenderThrottle::removeTerminal(TermWidgetImpl * term)
+{
+    m_displays.remove(term);
+    m_suspended.remove(term);
+}
+
+void RenderThrottle::propertiesChanged(Properties::Changes changes)
+{
+    if (!(changes & Properties::WindowOptions))
+        return;
+    foreach (TermWidgetImpl * term, m_displays.keys())
+        update(term);
+}
+
+bool RenderThrottle::eventFilter(QObject * obj, QEvent * event)
+{
+    switch (event->type())
+    {
+    case QEvent::Show:
+    case QEvent::Hide:
+    case QEvent::WindowStateChange:
+        break;
+    default:
+        return false;
+    }
+
+    if (m_windows.contains(obj))
+    {
+        // minimized, restored or the drop down shown/hidden
+        QHash<TermWidgetImpl*, QWidget*>::const_iterator it = m_displays.constBegin();
+        while (it != m_displays.constEnd())
+        {
+            if (it.value()->window() == obj)
+                update(it.key());
+            ++it;
+        }
+        return false;
+    }
+
+    QHash<TermWidgetImpl*, QWidget*>::const_iterator it = m_displays.constBegin();
+    while (it != m_displays.constEnd())
+    {
+        if (it.value() == obj)
+        {
+            // it may have been moved into another window (pool)
+            watchWindow(it.value()->window());
+            update(it.key());
+            break;
+        }
+        ++it;
+    }
+    return false;
+}
+
+void RenderThrottle::watchWindow(QWidget * window)
+{
+    if (m_windows.contains(window))
+        return;
+    m_windows.insert(window);
+    window->installEventFilter(this);
+    connect(window, SIGNAL(destroyed(QObject*)), this, SLOT(windowDestroyed(QObject*)));
+}
+
+void RenderThrottle::windowDestroyed(QObject * window)
+{
+    m_windows.remove(window);
+}
+
+void RenderThrottle::update(TermWidgetImpl * term)
+{
+    QWidget * display = m_displays.value(term);
+    if (!display)
+        return;
+
+    bool hidden = !display->isVisible() || display->window()->isMinimized();
+    bool suspended = m_suspended.contains(term);
+    if (isEnabled() && hidden && !suspended)
+        suspend(term);
+    else if ((!isEnabled() || !hidden) && suspended)
+        resume(term);
+}
+
+void RenderThrottle::suspend(TermWidgetImpl * term)
+{
+    QWidget * display = m_displays.value(term);
+    QList<QPointer<QTimer> > stopped;
+    foreach (QTimer * timer, display->findChildren<QTimer*>())
+    {
+        // the blink timers repeat; single shots (eg. the resize timer)
+        // finish their job and must not be started again on resume()
+        if (!timer->isActive() || timer->isSingleShot())
+            continue;
+        timer->stop();
+        stopped.append(timer);
+    }
+    m_suspended[term] = stopped;
+}
+
+void RenderThrottle::resume(TermWidgetImpl * term)
+{
+    foreach (QPointer<QTimer> timer, m_suspended.take(term))
+    {
+        if (timer)
+            timer->start();
+    }
+}
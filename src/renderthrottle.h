@@ -0,0 +1,72 @@
+#ifndef RENDERTHROTTLE_H
+#define RENDERTHROTTLE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+
+#include "properties.h"
+
+class TermWidgetImpl;
+
+
+/*! \brief No blinking in terminals nobody can see ("ThrottleHiddenTerminals").
+
+A terminal is suspended when its tab is not the current one or its
+window is minimized or hidden (drop down mode). Its display's own
+timers (cursor and text blinking) are stopped - they would wake the
+application up twice a second for nothing - and started again when it
+is shown. Qt doesn't paint hidden widgets anyway.
+
+The output of a hidden terminal still goes through the emulation's
+update timers and TerminalDisplay::updateImage(). Both are connected
+inside qtermwidget to objects its API doesn't expose (the emulation
+and its ScreenWindow), so they can't be suspended from here.
+
+Show/hide and window state changes are caught by event filters so
+there is no cost while nothing changes.
+*/
+class RenderThrottle : public QObject
+{
+    Q_OBJECT
+
+    public:
+        static RenderThrottle * Instance();
+
+        bool isEnabled() const;
+
+        void addTerminal(TermWidgetImpl * term);
+        void removeTerminal(TermWidgetImpl * term);
+
+        int suspendedCount() const { return m_suspended.count(); }
+
+    public slots:
+        void propertiesChanged(Properties::Changes changes = Properties::AllChanges);
+
+    protected:
+        bool eventFilter(QObject * obj, QEvent * event);
+
+    private:
+        RenderThrottle();
+
+        static RenderThrottle * m_instance;
+
+        //! TerminalDisplay of each terminal
+        QHash<TermWidgetImpl*, QWidget*> m_displays;
+        //! suspended terminals and the timers stopped for them
+        QHash<TermWidgetImpl*, QList<QPointer<QTimer> > > m_suspended;
+        QSet<QObject*> m_windows;
+
+        void update(TermWidgetImpl * term);
+        void suspend(TermWidgetImpl * term);
+        void resume(TermWidgetImpl * term);
+        void watchWindow(QWidget * window);
+
+    private slots:
+        void windowDestroyed(QObject * window);
+};
+
+#endif
@@ -0,0 +1,419 @@
+#include <QDir>
+#include <QDebug>
+
+#include "scrollbackarchive.h"
+
+
+//! lines per compressed chunk...
+static const int CHUNK_LINES = 1024;
+//! ...or less if they are long
+static const int CHUNK_BYTES = 256 * 1024;
+//! fast - the output keeps coming while we compress
+static const int COMPRESSION_LEVEL = 1;
+//! 32k bits - about 1 in 3 set for a chunk of typical output
+static const int TRIGRAM_FILTER_BYTES = 4096;
+//! rewrite the file when dropped chunks take more than half of it
+static const qint64 COMPACT_MIN_BYTES = 1024 * 1024;
+
+
+static int trigramBit(const QChar * p)
+{
+    uint h = p[0].unicode() * 0x9e3779b1u;
+    h ^= p[1].unicode() * 0x85ebca77u;
+    h ^= p[2].unicode() * 0xc2b2ae3du;
+    h ^= h >> 15;
+    return h % (TRIGRAM_FILTER_BYTES * 8);
+}
+
+//! \a text must be lower case
+static QByteArray trigramFilter(const QString & text)
+{
+    QByteArray filter(TRIGRAM_FILTER_BYTES, '\0');
+    char * bits = filter.data();
+    const QChar * p = text.unicode();
+    for (int i = 0; i + 2 < text.length(); ++i)
+    {
+        int bit = trigramBit(p + i);
+        bits[bit >> 3] |= 1 << (bit & 7);
+    }
+    return filter;
+}
+
+//! \a text must be lower case
+static QVector<int> queryTrigrams(const QString & text)
+{
+    QVector<int> ret;
+    const QChar * p = text.unicode();
+    for (int i = 0; i + 2 < text.length(); ++i)
+        ret.append(trigramBit(p + i));
+    return ret;
+}
+
+//! false if the chunk cannot contain the text; shorter texts always match
+static bool mayContain(const QByteArray & filter, const QVector<int> & trigrams)
+{
+    if (filter.isEmpty())
+        return true;
+    const char * bits = filter.constData();
+    foreach (int bit, trigrams)
+    {
+        if (!(bits[bit >> 3] & (1 << (bit & 7))))
+            return false;
+    }
+    return true;
+}
+
+static QStringList readChunk(QIODevice * file, const ScrollbackArchive::Chunk & c)
+{
+    QStringList lines;
+    if (file->seek(c.offset))
+    {
+        QByteArray data = qUncompress(file->read(c.length));
+        lines = QString::fromUtf8(data.constData(), data.size()).split('\n');
+    }
+    // a damaged chunk must not shift the line numbers
+    while (lines.count() < c.lines)
+        lines.append(QString());
+    return lines;
+}
+
+
+ScrollbackArchive::ScrollbackArchive()
+    : m_deadBytes(0),
+      m_lineLimit(0),
+      m_droppedLines(0),
+      m_lostLines(0),
+      m_chunkLines(0),
+      m_recentBytes(0),
+      m_cachedChunk(-1)
+{
+    m_file = createFile();
+}
+
+ScrollbackArchive::~ScrollbackArchive()
+{
+    delete m_file;
+}
+
+QTemporaryFile * ScrollbackArchive::createFile()
+{
+    QTemporaryFile * file = new QTemporaryFile(QDir::tempPath() + "/qterminal-history-XXXXXX");
+    if (file->open())
+        return file;
+
+    qDebug() << "ScrollbackArchive: cannot create" << file->fileTemplate();
+    delete file;
+    return 0;
+}
+
+void ScrollbackArchive::appendOutput(const QString & data)
+{
+    QStringList lines;
+    m_filter.filter(data, lines);
+    foreach (const QString & line, lines)
+        appendLine(line);
+}
+
+void ScrollbackArchive::appendLine(const QString & line)
+{
+    m_recent.append(line);
+    m_recentBytes += line.length() * sizeof(QChar);
+    if (m_recent.count() >= CHUNK_LINES || m_recentBytes >= CHUNK_BYTES)
+        compressRecent();
+}
+
+void ScrollbackArchive::clear()
+{
+    m_chunks.clear();
+    m_chunkLines = 0;
+    m_recent.clear();
+    m_recentBytes = 0;
+    m_cachedChunk = -1;
+    m_cachedLines.clear();
+    m_filter.reset();
+    m_lostLines = 0;
+
+    // a new file - running searches may still read the old one
+    if (m_file)
+    {
+        delete m_file;
+        m_file = createFile();
+        m_deadBytes = 0;
+    }
+}
+
+void ScrollbackArchive::setLineLimit(qint64 lines)
+{
+    m_lineLimit = lines;
+    trim();
+}
+
+void ScrollbackArchive::loseRecent()
+{
+    m_lostLines += m_recent.count();
+    m_recent.clear();
+    m_recentBytes = 0;
+}
+
+void ScrollbackArchive::compressRecent()
+{
+    if (m_recent.isEmpty())
+        return;
+    // clear() could not create a new file - it may work now
+    if (!m_file)
+    {
+        m_file = createFile();
+        m_deadBytes = 0;
+    }
+    if (!m_file)
+    {
+        loseRecent();
+        return;
+    }
+
+    QString text = m_recent.join("\n");
+    QByteArray data = qCompress(text.toUtf8(), COMPRESSION_LEVEL);
+
+    Chunk chunk;
+    chunk.firstLine = m_chunkLines;
+    chunk.offset = m_file->size();
+    chunk.length = data.size();
+    chunk.lines = m_recent.count();
+
+    // flushed for the searches reading the file in other threads
+    if (!m_file->seek(chunk.offset) || m_file->write(data) != data.size() || !m_file->flush())
+    {
+        // disk full. Keeping the lines would compress an ever growing list
+        // with each new line and never give the memory back - they are
+        // given up and the next chunk tries again.
+        qDebug() << "ScrollbackArchive: write failed" << m_file->errorString()
+                 << "-" << m_recent.count() << "lines lost";
+        m_file->resize(chunk.offset);
+        loseRecent();
+        return;
+    }
+
+    chunk.trigrams = trigramFilter(text.toLower());
+    m_chunks.append(chunk);
+    m_chunkLines += chunk.lines;
+    m_recent.clear();
+    m_recentBytes = 0;
+
+    trim();
+}
+
+void ScrollbackArchive::trim()
+{
+    if (m_lineLimit <= 0)
+        return;
+
+    // whole chunks only, so there are always at least m_lineLimit lines
+    int drop = 0;
+    qint64 dropped = 0;
+    while (drop < m_chunks.count()
+           && lineCount() - dropped - m_chunks.at(drop).lines >= m_lineLimit)
+    {
+        dropped += m_chunks.at(drop).lines;
+        m_deadBytes += m_chunks.at(drop).length;
+        ++drop;
+    }
+    if (!drop)
+        return;
+
+    m_chunks.remove(0, drop);
+    for (int i = 0; i < m_chunks.count(); ++i)
+        m_chunks[i].firstLine -= dropped;
+    m_chunkLines -= dropped;
+    m_droppedLines += dropped;
+    m_cachedChunk = -1;
+    m_cachedLines.clear();
+
+    if (m_deadBytes > COMPACT_MIN_BYTES && m_deadBytes > m_file->size() / 2)
+        compact();
+}
+
+void ScrollbackArchive::compact()
+{
+    // a new file - running searches may still read the old one
+    QTemporaryFile * file = createFile();
+    if (!file)
+        return;
+
+    QVector<Chunk> chunks = m_chunks;
+    qint64 offset = 0;
+    for (int i = 0; i < chunks.count(); ++i)
+    {
+        Chunk & c = chunks[i];
+        QByteArray data;
+        if (m_file->seek(c.offset))
+            data = m_file->read(c.length);
+        if (data.size() != c.length || file->write(data) != data.size())
+        {
+            qDebug() << "ScrollbackArchive: compaction failed" << file->errorString();
+            delete file;
+            return;
+        }
+        c.offset = offset;
+        offset += c.length;
+    }
+    file->flush();
+
+    delete m_file;
+    m_file = file;
+    m_chunks = chunks;
+    m_deadBytes = 0;
+}
+
+int ScrollbackArchive::chunkOf(qint64 n) const
+{
+    // the last chunk starting at or before n
+    int lo = 0;
+    int hi = m_chunks.count() - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (m_chunks.at(mid).firstLine <= n)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+const QStringList & ScrollbackArchive::chunkLines(int chunk)
+{
+    if (chunk != m_cachedChunk)
+    {
+        m_cachedLines = readChunk(m_file, m_chunks.at(chunk));
+        m_cachedChunk = chunk;
+    }
+    return m_cachedLines;
+}
+
+QString ScrollbackArchive::line(qint64 n)
+{
+    if (n < 0 || n >= lineCount())
+        return QString();
+    if (n >= m_chunkLines)
+        return m_recent.at(n - m_chunkLines);
+
+    int chunk = chunkOf(n);
+    return chunkLines(chunk).at(n - m_chunks.at(chunk).firstLine);
+}
+
+qint64 ScrollbackArchive::find(const QString & text, qint64 from, bool backwards,
+                               Qt::CaseSensitivity cs)
+{
+    if (text.isEmpty() || from < 0 || from >= lineCount())
+        return -1;
+
+    QVector<int> trigrams;
+    if (cs == Qt::CaseInsensitive)
+        trigrams = queryTrigrams(text.toLower());
+
+    // whole chunks at a time so each one is decompressed once
+    qint64 n = from;
+    while (n >= 0 && n < lineCount())
+    {
+        if (n >= m_chunkLines)
+        {
+            int i = n - m_chunkLines;
+            while (i >= 0 && i < m_recent.count())
+            {
+                if (m_recent.at(i).contains(text, cs))
+                    return m_chunkLines + i;
+                i += backwards ? -1 : 1;
+            }
+            n = m_chunkLines + i;
+            continue;
+        }
+
+        int chunk = chunkOf(n);
+        const Chunk & c = m_chunks.at(chunk);
+        if (!mayContain(c.trigrams, trigrams))
+        {
+            n = backwards ? c.firstLine - 1 : c.firstLine + c.lines;
+            continue;
+        }
+
+        const QStringList & lines = chunkLines(chunk);
+        int i = n - c.firstLine;
+        while (i >= 0 && i < c.lines)
+        {
+            if (lines.at(i).contains(text, cs))
+                return c.firstLine + i;
+            i += backwards ? -1 : 1;
+        }
+        n = c.firstLine + i;
+    }
+    return -1;
+}
+
+ScrollbackArchive::Snapshot ScrollbackArchive::snapshot() const
+{
+    Snapshot s;
+    if (m_file)
+        s.fileName = m_file->fileName();
+    s.chunks = m_chunks;
+    s.recent = m_recent;
+    return s;
+}
+
+QList<ScrollbackArchive::Match> ScrollbackArchive::search(const Snapshot & snapshot,
+                                                          const QString & text,
+                                                          int maxMatches, QAtomicInt * cancel)
+{
+    QList<Match> ret;
+    if (text.isEmpty())
+        return ret;
+
+    QVector<int> trigrams = queryTrigrams(text.toLower());
+    QFile file(snapshot.fileName);
+    // it may have been replaced (cleared, compacted) meanwhile
+    bool readable = !snapshot.chunks.isEmpty() && file.open(QIODevice::ReadOnly);
+
+    qint64 recentFirst = 0;
+    foreach (const Chunk & c, snapshot.chunks)
+    {
+        recentFirst = c.firstLine + c.lines;
+        if (cancel && cancel->fetchAndAddOrdered(0))
+            return ret;
+        if (!readable || !mayContain(c.trigrams, trigrams))
+            continue;
+
+        QStringList lines = readChunk(&file, c);
+        for (int i = 0; i < c.lines; ++i)
+        {
+            if (!lines.at(i).contains(text, Qt::CaseInsensitive))
+                continue;
+            Match m;
+            m.line = c.firstLine + i;
+            m.text = lines.at(i);
+            ret.append(m);
+            if (ret.count() >= maxMatches)
+                return ret;
+        }
+    }
+
+    for (int i = 0; i < snapshot.recent.count(); ++i)
+    {
+        if (!snapshot.recent.at(i).contains(text, Qt::CaseInsensitive))
+            continue;
+        Match m;
+        m.line = recentFirst + i;
+        m.text = snapshot.recent.at(i);
+        ret.append(m);
+        if (ret.count() >= maxMatches)
+            break;
+    }
+    return ret;
+}
+
+qint64 ScrollbackArchive::memoryBytes() const
+{
+    qint64 bytes = m_recentBytes + m_filter.pending().length() * sizeof(QChar);
+    foreach (const QString & s, m_cachedLines)
+        bytes += s.length() * sizeof(QChar);
+    bytes += (qint64)m_chunks.count() * (sizeof(Chunk) + TRIGRAM_FILTER_BYTES);
+    return bytes;
+}
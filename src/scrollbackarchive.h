@@ -0,0 +1,125 @@
+#ifndef SCROLLBACKARCHIVE_H
+#define SCROLLBACKARCHIVE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+#include <QAtomicInt>
+#include <QTemporaryFile>
+
+#include "plaintextfilter.h"
+
+
+/*! \brief Compressed on-disk copy of a terminal's output.
+
+The terminal output is reduced to plain text lines by PlainTextFilter.
+The newest lines stay in memory; full chunks are compressed with
+qCompress() and appended to a per-terminal temporary file which is
+removed on destruction.
+
+Every chunk is listed in an index sorted by its first line number so
+line() and find() locate a chunk by binary search and decompress only
+the chunks they need. The last decompressed chunk is cached for
+scrolling. Each chunk also has a Bloom filter of the trigrams of its
+(lower case) text; searches skip the chunks which cannot contain the
+text without reading them. The resident cost is the index, 4 kB of
+filter per chunk and two uncompressed chunks.
+
+With a line limit (limited history) the oldest chunks are dropped and
+the file is compacted from time to time. With unlimited history it is
+the history itself - the terminal keeps only the recent lines
+(Properties::archiveRecentLines), everything older is read from here.
+*/
+class ScrollbackArchive
+{
+    public:
+        struct Chunk
+        {
+            qint64 firstLine;
+            qint64 offset;
+            int length;
+            int lines;
+            QByteArray trigrams;
+        };
+
+        //! Read-only state for searching in another thread
+        struct Snapshot
+        {
+            QString fileName;
+            QVector<Chunk> chunks;
+            QStringList recent;
+        };
+
+        struct Match
+        {
+            qint64 line;
+            QString text;
+        };
+
+        ScrollbackArchive();
+        ~ScrollbackArchive();
+
+        //! false if the temporary file cannot be created
+        bool isValid() const { return m_file != 0; }
+
+        //! Raw terminal output, may contain escape sequences
+        void appendOutput(const QString & data);
+        void appendLine(const QString & line);
+        void clear();
+        //! Keep at least this many lines, 0 = unlimited
+        void setLineLimit(qint64 lines);
+
+        qint64 lineCount() const { return m_chunkLines + m_recent.count(); }
+        //! Lines removed by the limit so far; the line numbers shift by it
+        qint64 droppedLines() const { return m_droppedLines; }
+        //! Lines which could not be written (disk full), they are not counted
+        qint64 lostLines() const { return m_lostLines; }
+        QString line(qint64 n);
+        /*! Line number of the next line containing \a text starting
+            at \a from, -1 if there is none.
+         */
+        qint64 find(const QString & text, qint64 from, bool backwards,
+                    Qt::CaseSensitivity cs = Qt::CaseInsensitive);
+
+        Snapshot snapshot() const;
+        /*! Case insensitive search in \a snapshot, at most \a maxMatches.
+            It's thread safe and stops early when \a cancel is set.
+         */
+        static QList<Match> search(const Snapshot & snapshot, const QString & text,
+                                   int maxMatches, QAtomicInt * cancel);
+
+        //! Uncompressed lines, cache and index
+        qint64 memoryBytes() const;
+        qint64 diskBytes() const { return m_file ? m_file->size() : 0; }
+
+    private:
+        QTemporaryFile * m_file;
+        //! bytes of dropped chunks still in m_file
+        qint64 m_deadBytes;
+        qint64 m_lineLimit;
+        qint64 m_droppedLines;
+        qint64 m_lostLines;
+
+        QVector<Chunk> m_chunks;
+        //! lines stored in m_chunks
+        qint64 m_chunkLines;
+
+        QStringList m_recent;
+        int m_recentBytes;
+
+        int m_cachedChunk;
+        QStringList m_cachedLines;
+
+        PlainTextFilter m_filter;
+
+        QTemporaryFile * createFile();
+        void compressRecent();
+        void loseRecent();
+        void trim();
+        void compact();
+        int chunkOf(qint64 n) const;
+        const QStringList & chunkLines(int chunk);
+};
+
+#endif
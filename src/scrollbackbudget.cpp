@@ -0,0 +1,102 @@
+#include "scrollbackbudget.h"
+#include "termwidget.h"
+#include "properties.h"
+
+
+//! every terminal keeps at least this much if the budget allows it
+static const int FLOOR_LINES = 1000;
+//! focus changes come in bursts (Alt+Tab, tab switching)
+static const int REBALANCE_DELAY = 500;
+
+ScrollbackBudget * ScrollbackBudget::m_instance = 0;
+
+
+ScrollbackBudget * ScrollbackBudget::Instance()
+{
+    if (!m_instance)
+        m_instance = new ScrollbackBudget();
+    return m_instance;
+}
+
+ScrollbackBudget::ScrollbackBudget()
+    : QObject(0)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(rebalance()));
+}
+
+bool ScrollbackBudget::isEnabled() const
+{
+    return Properties::Instance()->scrollbackBudget > 0;
+}
+
+void ScrollbackBudget::addTerminal(TermWidgetImpl * term)
+{
+    // pooled terminals are created long before they are used -
+    // a terminal moves to the front only when it gets the focus
+    m_lru.append(term);
+    connect(term, SIGNAL(termGetFocus()), this, SLOT(termFocused()));
+    scheduleRebalance();
+}
+
+void ScrollbackBudget::removeTerminal(TermWidgetImpl * term)
+{
+    m_lru.removeAll(term);
+    m_allocated.remove(term);
+    scheduleRebalance();
+}
+
+void ScrollbackBudget::touch(TermWidgetImpl * term)
+{
+    if (!m_lru.isEmpty() && m_lru.first() == term)
+        return;
+    m_lru.removeAll(term);
+    m_lru.prepend(term);
+    scheduleRebalance();
+}
+
+void ScrollbackBudget::termFocused()
+{
+    TermWidgetImpl * term = qobject_cast<TermWidgetImpl*>(sender());
+    if (term)
+        touch(term);
+}
+
+void ScrollbackBudget::scheduleRebalance()
+{
+    if (isEnabled() || !m_allocated.isEmpty())
+        m_timer.start(REBALANCE_DELAY);
+}
+
+void ScrollbackBudget::rebalance()
+{
+    // TermWidgetImpl applies historyLimitedTo itself then
+    if (!isEnabled())
+    {
+        m_allocated.clear();
+        return;
+    }
+    if (m_lru.isEmpty())
+        return;
+
+    Properties * p = Properties::Instance();
+    int budget = p->scrollbackBudget;
+    // unlimited history wants everything that is left
+    int wish = p->historyLimited ? (int)p->historyLimitedTo : budget;
+    int floor = qMin(qMin(FLOOR_LINES, wish), budget / m_lru.count());
+    qint64 remaining = budget - (qint64)floor * m_lru.count();
+
+    foreach (TermWidgetImpl * term, m_lru)
+    {
+        int extra = (int)qMax<qint64>(0, qMin<qint64>(wish - floor, remaining));
+        remaining -= extra;
+        int lines = floor + extra;
+
+        // resizing the history is not free - touch only what differs
+        if (m_allocated.value(term, -1) != lines)
+        {
+            term->setHistorySize(lines);
+            m_allocated[term] = lines;
+        }
+    }
+}
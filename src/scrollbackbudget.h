@@ -0,0 +1,56 @@
+#ifndef SCROLLBACKBUDGET_H
+#define SCROLLBACKBUDGET_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QTimer>
+
+class TermWidgetImpl;
+
+
+/*! \brief Total history lines shared by all terminals ("ScrollbackBudget").
+
+Terminals are kept in most-recently-focused order. Each gets a small
+floor; the rest of the budget goes to the recent terminals first,
+up to the per-terminal history setting. The least recently used
+background terminals end up with the floor - qtermwidget drops their
+oldest lines when their history size is reduced.
+
+Rebalancing is debounced and applies only the sizes that have changed.
+With the budget off (0) terminals use Properties::historyLimitedTo.
+*/
+class ScrollbackBudget : public QObject
+{
+    Q_OBJECT
+
+    public:
+        static ScrollbackBudget * Instance();
+
+        bool isEnabled() const;
+
+        void addTerminal(TermWidgetImpl * term);
+        void removeTerminal(TermWidgetImpl * term);
+        //! \a term has been focused - it goes to the front
+        void touch(TermWidgetImpl * term);
+
+    public slots:
+        void scheduleRebalance();
+
+    private:
+        ScrollbackBudget();
+
+        static ScrollbackBudget * m_instance;
+
+        //! most recently used first
+        QList<TermWidgetImpl*> m_lru;
+        //! history size set by the last rebalance()
+        QHash<TermWidgetImpl*, int> m_allocated;
+        QTimer m_timer;
+
+    private slots:
+        void rebalance();
+        void termFocused();
+};
+
+#endif
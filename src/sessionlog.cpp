@@ -0,0 +1,455 @@
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QHash>
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QTime>
+#include <QCoreApplication>
+#include <QDebug>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "sessionlog.h"
+#include "plaintextfilter.h"
+#include "properties.h"
+
+
+//! messages in the ring, one per receivedData() chunk
+static const int RING_SIZE = 4096;
+//! queued but not yet written (UTF-16 bytes)
+static const int MAX_PENDING_BYTES = 16 * 1024 * 1024;
+//! the writer sleeps at most this long when there is nothing to do
+static const int IDLE_WAIT = 200;
+//! gzip sync points cost compression ratio
+static const int COMPRESSED_FLUSH_INTERVAL = 1000;
+//! how long shutdown() waits for the disk
+static const int SHUTDOWN_TIMEOUT = 5000;
+
+
+//! Log settings, copied from Properties when the log is opened
+struct LogConfig
+{
+    QString directory;
+    QString fileBase;
+    int mode;
+    bool compress;
+    qint64 rotateBytes;
+    int rotateSecs;
+};
+
+struct LogMessage
+{
+    LogMessage() : log(0), dropped(0) {}
+
+    int log;
+    QString data;
+    qint64 dropped;
+};
+
+
+/*! One log on the writer side. The file is opened by the first write
+    and after every rotation.
+ */
+class LogFile
+{
+public:
+    LogFile(const LogConfig & config)
+        : m_config(config),
+#ifdef HAVE_ZLIB
+          m_gz(0),
+#endif
+          m_size(0),
+          m_unflushed(false)
+    {
+#ifndef HAVE_ZLIB
+        if (m_config.compress)
+            qDebug() << "SessionLog: built without zlib, writing uncompressed";
+        m_config.compress = false;
+#endif
+    }
+
+    ~LogFile()
+    {
+        if (m_config.mode == SessionLog::PlainText && !m_filter.pending().isEmpty())
+            writeBytes((m_filter.pending() + '\n').toUtf8());
+        closeFile();
+    }
+
+    void write(const QString & data, qint64 dropped)
+    {
+        if (dropped)
+            writeBytes(QString("\n[qterminal: %1 bytes of output dropped]\n").arg(dropped).toUtf8());
+
+        if (m_config.mode == SessionLog::Raw)
+        {
+            writeBytes(data.toUtf8());
+            return;
+        }
+
+        QStringList lines;
+        m_filter.filter(data, lines);
+        if (!lines.isEmpty())
+            writeBytes((lines.join("\n") + '\n').toUtf8());
+    }
+
+    void flush()
+    {
+        if (!m_unflushed)
+            return;
+#ifdef HAVE_ZLIB
+        if (m_gz)
+        {
+            if (m_lastFlush.elapsed() < COMPRESSED_FLUSH_INTERVAL)
+                return;
+            gzflush(m_gz, Z_SYNC_FLUSH);
+            m_lastFlush.start();
+        }
+#endif
+        if (m_file.isOpen())
+            m_file.flush();
+        m_unflushed = false;
+    }
+
+private:
+    LogConfig m_config;
+    PlainTextFilter m_filter;
+    QFile m_file;
+#ifdef HAVE_ZLIB
+    gzFile m_gz;
+    QTime m_lastFlush;
+#endif
+    qint64 m_size;
+    QDateTime m_openedAt;
+    bool m_unflushed;
+
+    bool isOpen() const
+    {
+#ifdef HAVE_ZLIB
+        if (m_gz)
+            return true;
+#endif
+        return m_file.isOpen();
+    }
+
+    void openFile()
+    {
+        // the logs contain whatever has been typed - passwords, tokens.
+        // An existing directory is the user's choice and left alone
+        if (!QDir(m_config.directory).exists())
+        {
+            QDir().mkpath(m_config.directory);
+            QFile::setPermissions(m_config.directory,
+                                  QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+        }
+
+        QString base = QString("%1/qterminal-%2-%3-%4")
+                        .arg(m_config.directory)
+                        .arg(QCoreApplication::applicationPid())
+                        .arg(m_config.fileBase)
+                        .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+        QString suffix = m_config.compress ? ".log.gz" : ".log";
+        // rotated twice in a second
+        QString fname = base + suffix;
+        for (int i = 1; QFile::exists(fname); ++i)
+            fname = QString("%1-%2%3").arg(base).arg(i).arg(suffix);
+
+        m_size = 0;
+        m_openedAt = QDateTime::currentDateTime();
+#ifdef Q_OS_UNIX
+        // created private - gzopen() and QFile keep the mode of an existing file
+        int fd = ::open(QFile::encodeName(fname).constData(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0)
+            ::close(fd);
+#endif
+#ifdef HAVE_ZLIB
+        if (m_config.compress)
+        {
+            m_gz = gzopen(QFile::encodeName(fname).constData(), "wb1");
+            if (!m_gz)
+                qDebug() << "SessionLog: cannot create" << fname;
+            m_lastFlush.start();
+            return;
+        }
+#endif
+        m_file.setFileName(fname);
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append))
+            qDebug() << "SessionLog: cannot create" << fname << m_file.errorString();
+    }
+
+    void closeFile()
+    {
+#ifdef HAVE_ZLIB
+        if (m_gz)
+        {
+            gzclose(m_gz);
+            m_gz = 0;
+        }
+#endif
+        if (m_file.isOpen())
+            m_file.close();
+    }
+
+    void writeBytes(const QByteArray & bytes)
+    {
+        if (isOpen() && m_config.rotateSecs > 0
+            && m_openedAt.secsTo(QDateTime::currentDateTime()) >= m_config.rotateSecs)
+        {
+            closeFile();
+        }
+        if (!isOpen())
+            openFile();
+
+#ifdef HAVE_ZLIB
+        if (m_gz)
+            gzwrite(m_gz, bytes.constData(), bytes.size());
+        else
+#endif
+        if (m_file.isOpen())
+            m_file.write(bytes);
+
+        m_size += bytes.size();
+        m_unflushed = true;
+        if (m_config.rotateBytes > 0 && m_size >= m_config.rotateBytes)
+            closeFile();
+    }
+};
+
+
+/*! The writer thread. There is only one producer (the GUI thread) and
+    one consumer (run()) so the ring needs no lock; each side publishes
+    its position with an ordered store after touching the slot.
+    Logs are registered and closed under a mutex, which is rare.
+ */
+class SessionLogWriter : public QThread
+{
+public:
+    static SessionLogWriter * instance(bool create = true)
+    {
+        if (!m_instance && create)
+        {
+            m_instance = new SessionLogWriter();
+            m_instance->start(QThread::LowPriority);
+        }
+        return m_instance;
+    }
+
+    int open(const LogConfig & config)
+    {
+        QMutexLocker lock(&m_mutex);
+        int id = ++m_lastId;
+        m_opened[id] = config;
+        return id;
+    }
+
+    void close(int log)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_closed.append(log);
+        lock.unlock();
+        m_wake.wakeOne();
+    }
+
+    bool push(int log, const QString & data, qint64 dropped)
+    {
+        if (m_stopped)
+            return false;
+
+        int head = m_head.fetchAndAddOrdered(0);
+        int tail = m_tail.fetchAndAddOrdered(0);
+        int next = (head + 1) % RING_SIZE;
+        int bytes = data.size() * sizeof(QChar);
+        if (next == tail || m_pendingBytes.fetchAndAddOrdered(0) + bytes > MAX_PENDING_BYTES)
+            return false;
+
+        LogMessage & msg = m_ring[head];
+        msg.log = log;
+        msg.data = data;
+        msg.dropped = dropped;
+        m_pendingBytes.fetchAndAddOrdered(bytes);
+        m_head.fetchAndStoreOrdered(next);
+
+        // it may be sleeping only if there was nothing to do
+        if (head == tail)
+            m_wake.wakeOne();
+        return true;
+    }
+
+    void stop()
+    {
+        m_stopped = true;
+        QMutexLocker lock(&m_mutex);
+        m_stop = true;
+        lock.unlock();
+        m_wake.wakeOne();
+        if (!wait(SHUTDOWN_TIMEOUT))
+            qDebug() << "SessionLog: writer did not finish in time";
+    }
+
+protected:
+    void run()
+    {
+        forever
+        {
+            // read before draining: all the data of these logs is queued already
+            QMutexLocker lock(&m_mutex);
+            takeOpened();
+            QList<int> closed = m_closed;
+            m_closed.clear();
+            bool stop = m_stop;
+            lock.unlock();
+
+            bool busy = drain();
+
+            foreach (int log, closed)
+                delete m_files.take(log);
+            foreach (LogFile * f, m_files)
+                f->flush();
+
+            if (stop)
+                break;
+            if (!busy && closed.isEmpty())
+            {
+                m_wakeMutex.lock();
+                m_wake.wait(&m_wakeMutex, IDLE_WAIT);
+                m_wakeMutex.unlock();
+            }
+        }
+
+        qDeleteAll(m_files);
+        m_files.clear();
+    }
+
+private:
+    static SessionLogWriter * m_instance;
+
+    LogMessage m_ring[RING_SIZE];
+    QAtomicInt m_head;
+    QAtomicInt m_tail;
+    QAtomicInt m_pendingBytes;
+    //! GUI thread only
+    bool m_stopped;
+    int m_lastId;
+
+    //! protects m_opened, m_closed and m_stop
+    QMutex m_mutex;
+    QHash<int, LogConfig> m_opened;
+    QList<int> m_closed;
+    bool m_stop;
+
+    QMutex m_wakeMutex;
+    QWaitCondition m_wake;
+
+    //! writer thread only
+    QHash<int, LogFile*> m_files;
+
+    SessionLogWriter()
+        : m_head(0),
+          m_tail(0),
+          m_pendingBytes(0),
+          m_stopped(false),
+          m_lastId(0),
+          m_stop(false)
+    {
+    }
+
+    //! m_mutex must be locked
+    void takeOpened()
+    {
+        QHash<int, LogConfig>::const_iterator it = m_opened.constBegin();
+        while (it != m_opened.constEnd())
+        {
+            m_files[it.key()] = new LogFile(it.value());
+            ++it;
+        }
+        m_opened.clear();
+    }
+
+    //! Write what is in the ring, false if it was empty
+    bool drain()
+    {
+        bool busy = false;
+        forever
+        {
+            int tail = m_tail.fetchAndAddOrdered(0);
+            if (tail == m_head.fetchAndAddOrdered(0))
+                break;
+
+            LogMessage msg = m_ring[tail];
+            // release the string here, not when the slot is reused
+            m_ring[tail] = LogMessage();
+            m_tail.fetchAndStoreOrdered((tail + 1) % RING_SIZE);
+            m_pendingBytes.fetchAndAddOrdered(-(int)(msg.data.size() * sizeof(QChar)));
+            busy = true;
+
+            LogFile * f = m_files.value(msg.log);
+            if (!f)
+            {
+                // opened after the last takeOpened()
+                QMutexLocker lock(&m_mutex);
+                takeOpened();
+                f = m_files.value(msg.log);
+            }
+            if (f)
+                f->write(msg.data, msg.dropped);
+        }
+        return busy;
+    }
+};
+
+SessionLogWriter * SessionLogWriter::m_instance = 0;
+
+
+SessionLog::SessionLog(const QString & name)
+    : m_dropped(0),
+      m_unreported(0)
+{
+    Properties * p = Properties::Instance();
+    LogConfig config;
+    config.directory = p->sessionLogDirectory;
+    config.fileBase = name;
+    config.mode = p->sessionLogMode;
+    config.compress = p->sessionLogCompress;
+    config.rotateBytes = (qint64)p->sessionLogRotateSize * 1024 * 1024;
+    config.rotateSecs = p->sessionLogRotateHours * 3600;
+
+    m_id = SessionLogWriter::instance()->open(config);
+}
+
+SessionLog::~SessionLog()
+{
+    SessionLogWriter * writer = SessionLogWriter::instance(false);
+    if (writer)
+        writer->close(m_id);
+    if (m_dropped)
+        qDebug() << "SessionLog:" << m_dropped << "bytes dropped in log" << m_id;
+}
+
+void SessionLog::append(const QString & data)
+{
+    if (SessionLogWriter::instance()->push(m_id, data, m_unreported))
+    {
+        m_unreported = 0;
+        return;
+    }
+    qint64 bytes = data.size() * sizeof(QChar);
+    m_dropped += bytes;
+    m_unreported += bytes;
+}
+
+void SessionLog::shutdown()
+{
+    SessionLogWriter * writer = SessionLogWriter::instance(false);
+    if (writer)
+        writer->stop();
+}
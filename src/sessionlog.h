@@ -0,0 +1,49 @@
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <QString>
+
+
+/*! \brief Output log of one terminal ("SessionLog/..." settings).
+
+append() hands the output to a single writer thread shared by all
+logs through a fixed size lock-free ring buffer. The GUI thread never
+waits for the disk: when the ring or its byte limit is full the data
+is dropped, counted and a "bytes dropped" note is written to the log
+with the next data which gets through.
+
+The writer strips escape sequences (PlainText, see PlainTextFilter)
+or writes the output as is (Raw), optionally gzip compressed, and
+starts a new file when the size or age limit is reached. Files are
+named <directory>/qterminal-<pid>-<name>-<date>-<time>.log[.gz].
+*/
+class SessionLog
+{
+    public:
+        enum Mode {
+            Off = 0,
+            PlainText,
+            Raw
+        };
+
+        //! \a name identifies the terminal in the file names
+        SessionLog(const QString & name);
+        ~SessionLog();
+
+        //! Queue \a data for writing. It never blocks.
+        void append(const QString & data);
+
+        //! Bytes (UTF-16) lost because the writer was behind
+        qint64 droppedBytes() const { return m_dropped; }
+
+        //! Write everything queued and stop the writer thread (on exit)
+        static void shutdown();
+
+    private:
+        int m_id;
+        qint64 m_dropped;
+        //! dropped since the last successful append()
+        qint64 m_unreported;
+};
+
+#endif
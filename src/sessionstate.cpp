@@ -0,0 +1,135 @@
+#include <QUrl>
+
+#include "sessionstate.h"
+
+
+static const char * const MAGIC = "qterminal-session";
+static const int VERSION = 1;
+//! a broken state must not build a huge tree
+static const int MAX_DEPTH = 32;
+
+
+static QString encode(const QString & s)
+{
+    if (s.isEmpty())
+        return "-";
+    // '-' alone is the empty string
+    return QString::fromLatin1(QUrl::toPercentEncoding(s, QByteArray(), "-"));
+}
+
+static QString decode(const QString & s)
+{
+    if (s == "-")
+        return QString();
+    return QUrl::fromPercentEncoding(s.toLatin1());
+}
+
+
+QString SessionState::toString() const
+{
+    QStringList lines;
+    lines << QString("%1 %2").arg(MAGIC).arg(VERSION);
+    foreach (const Window & w, windows)
+    {
+        QString geometry(w.geometry.isEmpty() ? QString("-") : QString::fromLatin1(w.geometry.toBase64()));
+        lines << QString("w %1 %2").arg(geometry).arg(w.currentTab);
+        foreach (const Tab & t, w.tabs)
+        {
+            lines << "t " + encode(t.title);
+            writeNode(t.layout, lines);
+        }
+    }
+    return lines.join("\n");
+}
+
+void SessionState::writeNode(const Node & node, QStringList & lines)
+{
+    if (node.isPane())
+    {
+        lines << QString("p %1 %2").arg(encode(node.wdir)).arg(encode(node.command));
+        return;
+    }
+
+    QStringList sizes;
+    foreach (int size, node.sizes)
+        sizes << QString::number(size);
+    lines << QString("s %1 %2 %3").arg(node.vertical ? "v" : "h")
+                                  .arg(sizes.isEmpty() ? QString("-") : sizes.join(","))
+                                  .arg(node.children.count());
+    foreach (const Node & child, node.children)
+        writeNode(child, lines);
+}
+
+bool SessionState::fromString(const QString & text)
+{
+    windows.clear();
+    QStringList lines = text.split('\n', QString::SkipEmptyParts);
+    if (lines.isEmpty())
+        return false;
+
+    QStringList header = lines.at(0).split(' ');
+    if (header.count() != 2 || header.at(0) != MAGIC || header.at(1).toInt() != VERSION)
+        return false;
+
+    int pos = 1;
+    while (pos < lines.count())
+    {
+        QStringList f = lines.at(pos++).split(' ');
+        if (f.at(0) == "w" && f.count() == 3)
+        {
+            Window w;
+            if (f.at(1) != "-")
+                w.geometry = QByteArray::fromBase64(f.at(1).toLatin1());
+            w.currentTab = f.at(2).toInt();
+            windows.append(w);
+        }
+        else if (f.at(0) == "t" && f.count() == 2 && !windows.isEmpty())
+        {
+            Tab t;
+            t.title = decode(f.at(1));
+            if (!readNode(lines, pos, t.layout, 0))
+                return false;
+            windows.last().tabs.append(t);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SessionState::readNode(const QStringList & lines, int & pos, Node & node, int depth)
+{
+    if (pos >= lines.count() || depth > MAX_DEPTH)
+        return false;
+
+    QStringList f = lines.at(pos++).split(' ');
+    if (f.at(0) == "p" && f.count() == 3)
+    {
+        node.wdir = decode(f.at(1));
+        node.command = decode(f.at(2));
+        return true;
+    }
+    if (f.at(0) != "s" || f.count() != 4)
+        return false;
+
+    node.vertical = f.at(1) == "v";
+    if (f.at(2) != "-")
+    {
+        foreach (const QString & size, f.at(2).split(','))
+            node.sizes << size.toInt();
+    }
+    int count = f.at(3).toInt();
+    if (count < 1)
+        return false;
+
+    for (int i = 0; i < count; ++i)
+    {
+        Node child;
+        if (!readNode(lines, pos, child, depth + 1))
+            return false;
+        node.children.append(child);
+    }
+    return true;
+}
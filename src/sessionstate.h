@@ -0,0 +1,70 @@
+#ifndef SESSIONSTATE_H
+#define SESSIONSTATE_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QByteArray>
+
+
+/*! \brief Saved windows, tabs and split layouts ("Sessions/N/state").
+
+The text form is versioned and compact - one line per window, tab,
+splitter and pane in depth first order:
+
+\code
+qterminal-session 1
+w <geometry> <current tab>
+t <title>
+s <h|v> <size,size,...> <child count>
+p <working directory> <command>
+\endcode
+
+Strings are percent encoded, "-" is an empty string. See
+TabWidget::saveTabs() and TabWidget::restoreTabs().
+*/
+class SessionState
+{
+    public:
+        //! A pane (no children) or a splitter
+        struct Node
+        {
+            Node() : vertical(false) {}
+            bool isPane() const { return children.isEmpty(); }
+
+            //! Qt::Vertical splitter - panes one above the other
+            bool vertical;
+            QList<int> sizes;
+            QList<Node> children;
+
+            QString wdir;
+            //! empty is the default shell
+            QString command;
+        };
+
+        struct Tab
+        {
+            QString title;
+            Node layout;
+        };
+
+        struct Window
+        {
+            Window() : currentTab(0) {}
+            QByteArray geometry;
+            int currentTab;
+            QList<Tab> tabs;
+        };
+
+        QList<Window> windows;
+
+        QString toString() const;
+        //! false for a malformed or newer state
+        bool fromString(const QString & text);
+
+    private:
+        static void writeNode(const Node & node, QStringList & lines);
+        static bool readNode(const QStringList & lines, int & pos, Node & node, int depth);
+};
+
+#endif
@@ -0,0 +1,110 @@
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+
+#include "startuptrace.h"
+
+
+struct TraceEvent
+{
+    const char * name;
+    qint64 begin;
+    qint64 end;
+    quint64 tid;
+};
+
+static QElapsedTimer s_clock;
+static QMutex s_mutex;
+static QList<TraceEvent> s_events;
+static QString s_output;
+// start() turns it on until main() knows if tracing was requested
+static bool s_recording = false;
+
+
+static QString jsonEscape(const char * str)
+{
+    QString s = QString::fromLatin1(str);
+    s.replace('\\', "\\\\");
+    s.replace('"', "\\\"");
+    return s;
+}
+
+void StartupTrace::start()
+{
+    s_clock.start();
+    s_recording = true;
+}
+
+void StartupTrace::setOutput(const QString & fname)
+{
+    QMutexLocker locker(&s_mutex);
+    s_output = fname;
+    if (s_output.isEmpty())
+    {
+        s_recording = false;
+        s_events.clear();
+    }
+}
+
+bool StartupTrace::isEnabled()
+{
+    return s_recording;
+}
+
+qint64 StartupTrace::now()
+{
+    return s_clock.nsecsElapsed() / 1000;
+}
+
+void StartupTrace::addSpan(const char * name, qint64 begin, qint64 end)
+{
+    QMutexLocker locker(&s_mutex);
+    if (!s_recording)
+        return;
+
+    TraceEvent e;
+    e.name = name;
+    e.begin = begin;
+    e.end = end;
+    e.tid = (quint64)(quintptr)QThread::currentThreadId();
+    s_events.append(e);
+}
+
+void StartupTrace::finish()
+{
+    QMutexLocker locker(&s_mutex);
+    if (!s_recording)
+        return;
+    s_recording = false;
+
+    QFile f(s_output);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        qDebug() << "StartupTrace: cannot write to" << s_output;
+        return;
+    }
+
+    qint64 pid = QCoreApplication::applicationPid();
+    QTextStream out(&f);
+    out << "{\"traceEvents\":[\n";
+    for (int i = 0; i < s_events.count(); ++i)
+    {
+        const TraceEvent & e = s_events.at(i);
+        out << "{\"name\":\"" << jsonEscape(e.name) << "\","
+            << "\"cat\":\"startup\",\"ph\":\"X\","
+            << "\"ts\":" << e.begin << ","
+            << "\"dur\":" << (e.end - e.begin) << ","
+            << "\"pid\":" << pid << ","
+            << "\"tid\":" << e.tid << "}";
+        out << (i < s_events.count() - 1 ? ",\n" : "\n");
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}\n";
+
+    s_events.clear();
+    qDebug() << "StartupTrace: written to" << s_output;
+}
@@ -0,0 +1,52 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QString>
+
+
+/*! \brief Startup phase tracing (--trace-startup).
+
+Timed spans are collected from the very beginning of main() until
+the first terminal display is painted. Then they are written to the
+output file as Chrome trace-event JSON (chrome://tracing, Perfetto).
+When no output file is set recording stops and costs nothing.
+*/
+class StartupTrace
+{
+    public:
+        //! Start the clock. Call it as the first thing in main()
+        static void start();
+        //! Set the output file. Empty name disables tracing
+        static void setOutput(const QString & fname);
+        static bool isEnabled();
+
+        //! Microseconds since start()
+        static qint64 now();
+        static void addSpan(const char * name, qint64 begin, qint64 end);
+
+        //! Write the collected spans and stop recording
+        static void finish();
+};
+
+
+//! Records a span for the lifetime of the object
+class TraceSpan
+{
+    public:
+        TraceSpan(const char * name)
+            : m_name(name),
+              m_begin(StartupTrace::isEnabled() ? StartupTrace::now() : 0)
+        {
+        }
+        ~TraceSpan()
+        {
+            if (StartupTrace::isEnabled())
+                StartupTrace::addSpan(m_name, m_begin, StartupTrace::now());
+        }
+
+    private:
+        const char * m_name;
+        qint64 m_begin;
+};
+
+#endif
@@ -22,14 +22,19 @@
 #include <QInputDialog>
 #include <QMouseEvent>
 #include <QMenu>
+#include <QToolTip>
+#include <QHelpEvent>
+#include <QApplication>
+#include <QClipboard>
 
 #include "termwidgetholder.h"
 #include "tabwidget.h"
 #include "config.h"
 #include "properties.h"
-
-
-#define TAB_INDEX_PROPERTY "tab_index"
+#include "startuptrace.h"
+#include "memoryaccounting.h"
+#include "activitymonitor.h"
+#include "inputbroadcaster.h"
 
 
 TabWidget::TabWidget(QWidget* parent) : QTabWidget(parent), tabNumerator(0)
@@ -51,7 +56,8 @@ TabWidget::TabWidget(QWidget* parent) : QTabWidget(parent), tabNumerator(0)
     tabBar()->installEventFilter(this);
 
     connect(this, SIGNAL(tabCloseRequested(int)), this, SLOT(removeTab(int)));
-    connect(tabBar(), SIGNAL(tabMoved(int,int)), this, SLOT(updateTabIndices()));
+    connect(this, SIGNAL(currentChanged(int)), this, SLOT(materializeTab(int)));
+    connect(this, SIGNAL(currentChanged(int)), ActivityMonitor::Instance(), SLOT(tabShown(int)));
 }
 
 TermWidgetHolder * TabWidget::terminalHolder()
@@ -66,6 +72,7 @@ void TabWidget::setWorkDirectory(const QString& dir)
 
 int TabWidget::addNewTab(const QString & shell_program)
 {
+    TraceSpan trace("TabWidget::addNewTab");
     tabNumerator++;
     QString label = QString(tr("Shell No. %1")).arg(tabNumerator);
 
@@ -78,14 +85,8 @@ int TabWidget::addNewTab(const QString & shell_program)
             cwd = work_dir;
     }
 
-    TermWidgetHolder *console = new TermWidgetHolder(cwd, shell_program, this);
-    connect(console, SIGNAL(finished()), SLOT(removeFinished()));
-    //connect(console, SIGNAL(lastTerminalClosed()), this, SLOT(removeCurrentTab()));
-    connect(console, SIGNAL(lastTerminalClosed()), this, SLOT(removeFinished()));
-    connect(console, SIGNAL(renameSession()), this, SLOT(renameSession()));
-
+    TermWidgetHolder *console = newHolder(cwd, shell_program, false);
     int index = addTab(console, label);
-    updateTabIndices();
     setCurrentIndex(index);
     console->setInitialFocus();
 
@@ -94,6 +95,39 @@ int TabWidget::addNewTab(const QString & shell_program)
     return index;
 }
 
+int TabWidget::addDeferredTab(const QString& label, const QString& wdir,
+                              const QString& shell_program)
+{
+    tabNumerator++;
+
+    TermWidgetHolder *console = newHolder(wdir.isEmpty() ? work_dir : wdir, shell_program, true);
+    int index = addTab(console, label.isEmpty() ? QString(tr("Shell No. %1")).arg(tabNumerator) : label);
+    showHideTabBar();
+
+    return index;
+}
+
+TermWidgetHolder * TabWidget::newHolder(const QString& wdir, const QString& shell_program, bool deferred)
+{
+    TermWidgetHolder *console = new TermWidgetHolder(wdir, shell_program, this, deferred);
+    m_holders.insert(console->id(), console);
+    connect(console, SIGNAL(finished()), SLOT(removeFinished()));
+    //connect(console, SIGNAL(lastTerminalClosed()), this, SLOT(removeCurrentTab()));
+    connect(console, SIGNAL(lastTerminalClosed()), this, SLOT(removeFinished()));
+    connect(console, SIGNAL(renameSession()), this, SLOT(renameSession()));
+    return console;
+}
+
+void TabWidget::materializeTab(int index)
+{
+    TermWidgetHolder *console = qobject_cast<TermWidgetHolder*>(widget(index));
+    if (console && !console->isMaterialized())
+    {
+        console->materialize();
+        console->setInitialFocus();
+    }
+}
+
 void TabWidget::switchNextSubterminal()
 {
     terminalHolder()->switchNextSubterminal();
@@ -104,6 +138,26 @@ void TabWidget::switchPrevSubterminal()
     terminalHolder()->switchPrevSubterminal();
 }
 
+void TabWidget::switchLeftSubterminal()
+{
+    terminalHolder()->switchSubterminal(TermWidgetHolder::Left);
+}
+
+void TabWidget::switchRightSubterminal()
+{
+    terminalHolder()->switchSubterminal(TermWidgetHolder::Right);
+}
+
+void TabWidget::switchUpperSubterminal()
+{
+    terminalHolder()->switchSubterminal(TermWidgetHolder::Up);
+}
+
+void TabWidget::switchLowerSubterminal()
+{
+    terminalHolder()->switchSubterminal(TermWidgetHolder::Down);
+}
+
 void TabWidget::splitHorizontally()
 {
     terminalHolder()->splitHorizontal(terminalHolder()->currentTerminal());
@@ -126,12 +180,18 @@ void TabWidget::copySelection()
 
 void TabWidget::pasteClipboard()
 {
-    terminalHolder()->currentTerminal()->impl()->pasteClipboard();
+    TermWidgetImpl *term = terminalHolder()->currentTerminal()->impl();
+    term->pasteClipboard();
+    if (InputBroadcaster::Instance()->contains(term))
+        InputBroadcaster::Instance()->paste(term, QApplication::clipboard()->text(QClipboard::Clipboard));
 }
 
 void TabWidget::pasteSelection()
 {
-    terminalHolder()->currentTerminal()->impl()->pasteSelection();
+    TermWidgetImpl *term = terminalHolder()->currentTerminal()->impl();
+    term->pasteSelection();
+    if (InputBroadcaster::Instance()->contains(term))
+        InputBroadcaster::Instance()->paste(term, QApplication::clipboard()->text(QClipboard::Selection));
 }
 
 void TabWidget::zoomIn()
@@ -149,12 +209,6 @@ void TabWidget::zoomReset()
     terminalHolder()->currentTerminal()->impl()->zoomReset();
 }
 
-void TabWidget::updateTabIndices()
-{
-    for(int i = 0; i < count(); i++)
-        widget(i)->setProperty(TAB_INDEX_PROPERTY, i);
-}
-
 void TabWidget::renameSession()
 {
     bool ok = false;
@@ -201,17 +255,31 @@ bool TabWidget::eventFilter(QObject *obj, QEvent *event)
             renameSession();
         return true;
     }
+    if (event->type() == QEvent::ToolTip)
+    {
+        // computed on demand - it walks the terminal widgets
+        QHelpEvent *e = static_cast<QHelpEvent*>(event);
+        int index = tabBar()->tabAt(e->pos());
+        TermWidgetHolder *holder = qobject_cast<TermWidgetHolder*>(widget(index));
+        if (holder)
+        {
+            QToolTip::showText(e->globalPos(),
+                               tr("%1\nMemory: %2").arg(tabText(index))
+                                    .arg(MemoryAccounting::formatSize(MemoryAccounting::tabUsage(holder))),
+                               tabBar());
+            return true;
+        }
+    }
     return QTabWidget::eventFilter(obj, event);
 }
 
 void TabWidget::removeFinished()
 {
-    QObject* term = sender();
-    QVariant prop = term->property(TAB_INDEX_PROPERTY);
-    if(prop.isValid() && prop.canConvert(QVariant::Int))
+    // unlike its index, the id of the tab does not change when tabs move
+    TermWidgetHolder* console = qobject_cast<TermWidgetHolder*>(sender());
+    if (console && m_holders.contains(console->id()))
     {
-        int index = prop.toInt();
-        removeTab(index);
+        removeTab(indexOf(console));
 //        if (count() == 0)
 //            emit closeTabNotification();
     }
@@ -221,11 +289,11 @@ void TabWidget::removeTab(int index)
 {
     setUpdatesEnabled(false);
 
-    QWidget * w = widget(index);
+    TermWidgetHolder * w = static_cast<TermWidgetHolder*>(widget(index));
+    m_holders.remove(w->id());
     QTabWidget::removeTab(index);
     w->deleteLater();
 
-    updateTabIndices();
     int current = currentIndex();
     if (current >= 0 )
     {
@@ -287,6 +355,7 @@ void TabWidget::move(Direction dir)
         QString label   = tabText(index);
         QString toolTip = tabToolTip(index);
         QIcon   icon    = tabIcon(index);
+        QColor  color   = tabBar()->tabTextColor(index);
 
         int newIndex = 0;
         if(dir == Left)
@@ -305,10 +374,10 @@ void TabWidget::move(Direction dir)
         newIndex = insertTab(newIndex, child, label);
         setTabToolTip(newIndex, toolTip);
         setTabIcon(newIndex, icon);
+        tabBar()->setTabTextColor(newIndex, color);
         setUpdatesEnabled(true);
         setCurrentIndex(newIndex);
         child->setFocus();
-        updateTabIndices();
     }
 }
 
@@ -333,7 +402,7 @@ void TabWidget::changeScrollPosition(QAction *triggered)
             scrollPosition->actions().indexOf(triggered);
 
     Properties::Instance()->saveSettings();
-    propertiesChanged();
+    Properties::Instance()->notifyChanged();
 
 }
 
@@ -349,17 +418,23 @@ void TabWidget::changeTabPosition(QAction *triggered)
     setTabPosition(position);
     prop->tabsPos = position;
     prop->saveSettings();
+    // other windows follow
+    prop->notifyChanged();
     return;
 }
 
-void TabWidget::propertiesChanged()
+void TabWidget::propertiesChanged(Properties::Changes changes)
 {
-    for (int i = 0; i < count(); ++i)
+    if (changes & Properties::TerminalChanges)
     {
-        TermWidgetHolder *console = static_cast<TermWidgetHolder*>(widget(i));
-        console->propertiesChanged();
+        for (int i = 0; i < count(); ++i)
+        {
+            TermWidgetHolder *console = static_cast<TermWidgetHolder*>(widget(i));
+            console->propertiesChanged(changes);
+        }
     }
-    showHideTabBar();
+    if (changes & Properties::WindowOptions)
+        showHideTabBar();
 }
 
 void TabWidget::clearActiveTerminal()
@@ -367,15 +442,45 @@ void TabWidget::clearActiveTerminal()
     reinterpret_cast<TermWidgetHolder*>(widget(currentIndex()))->clearActiveTerminal();
 }
 
-void TabWidget::saveSession()
+void TabWidget::setSynchronizeInput(bool enable)
 {
-    int ix = currentIndex();
-    reinterpret_cast<TermWidgetHolder*>(widget(ix))->saveSession(tabText(ix));
+    TermWidgetHolder *holder = terminalHolder();
+    if (!holder)
+        return;
+    holder->setSynchronizeInput(enable);
+    // an invalid color is the default one
+    tabBar()->setTabTextColor(currentIndex(), enable ? QColor(Qt::red) : QColor());
+}
+
+void TabWidget::saveTabs(SessionState::Window& state)
+{
+    state.currentTab = currentIndex();
+    for (int i = 0; i < count(); ++i)
+    {
+        SessionState::Tab tab;
+        tab.title = tabText(i);
+        tab.layout = static_cast<TermWidgetHolder*>(widget(i))->layoutState();
+        state.tabs.append(tab);
+    }
 }
 
-void TabWidget::loadSession()
+void TabWidget::restoreTabs(const SessionState::Window& state)
 {
-    reinterpret_cast<TermWidgetHolder*>(widget(currentIndex()))->loadSession();
+    setUpdatesEnabled(false);
+    // the first tab added to an empty TabWidget becomes current - it may be another one
+    disconnect(this, SIGNAL(currentChanged(int)), this, SLOT(materializeTab(int)));
+    int first = count();
+    foreach (const SessionState::Tab& tab, state.tabs)
+    {
+        int index = addDeferredTab(tab.title, work_dir);
+        static_cast<TermWidgetHolder*>(widget(index))->setLayoutState(tab.layout);
+    }
+    if (state.currentTab >= 0 && first + state.currentTab < count())
+        setCurrentIndex(first + state.currentTab);
+    connect(this, SIGNAL(currentChanged(int)), this, SLOT(materializeTab(int)));
+    materializeTab(currentIndex());
+    setUpdatesEnabled(true);
+    showHideTabBar();
 }
 
 void TabWidget::preset2Horizontal()
@@ -23,8 +23,10 @@
 
 #include <QTabWidget>
 #include <QMap>
+#include <QHash>
 
 #include "properties.h"
+#include "sessionstate.h"
 
 class TermWidgetHolder;
 class QAction;
@@ -38,9 +40,24 @@ public:
     TabWidget(QWidget* parent = 0);
 
     TermWidgetHolder * terminalHolder();
+    //! The tab with TermWidgetHolder::id() \a id, 0 if it is not in this window
+    TermWidgetHolder * holder(int id) const { return m_holders.value(id); }
 
     void showHideTabBar();
 
+    /*! Add a placeholder tab. Its shell is not started until the tab
+        becomes current for the first time - see materializeTab().
+     */
+    int addDeferredTab(const QString& label, const QString& wdir,
+                       const QString& shell_program = QString());
+
+    //! Titles and layouts of all tabs
+    void saveTabs(SessionState::Window& state);
+    /*! Append the tabs of \a state as deferred tabs - only the current
+        one gets its terminals now.
+     */
+    void restoreTabs(const SessionState::Window& state);
+
 public slots:
     int addNewTab(const QString& shell_program = QString());
     void removeTab(int);
@@ -55,6 +72,10 @@ public slots:
 
     void switchNextSubterminal();
     void switchPrevSubterminal();
+    void switchLeftSubterminal();
+    void switchRightSubterminal();
+    void switchUpperSubterminal();
+    void switchLowerSubterminal();
     void splitHorizontally();
     void splitVertically();
     void splitCollapse();
@@ -68,12 +89,11 @@ public slots:
 
     void changeTabPosition(QAction *);
     void changeScrollPosition(QAction *);
-    void propertiesChanged();
+    void propertiesChanged(Properties::Changes changes = Properties::AllChanges);
 
     void clearActiveTerminal();
-
-    void saveSession();
-    void loadSession();
+    //! Synchronize the input of the current tab, see TermWidgetHolder
+    void setSynchronizeInput(bool enable);
 
     void preset2Horizontal();
     void preset2Vertical();
@@ -93,13 +113,16 @@ protected:
      */
     bool eventFilter(QObject *obj, QEvent *event);
 protected slots:
-    void updateTabIndices();
+    void materializeTab(int index);
 
 private:
     int tabNumerator;
     QString work_dir;
+    //! all tabs by TermWidgetHolder::id()
+    QHash<int, TermWidgetHolder*> m_holders;
     /* re-order naming of the tabs then removeCurrentTab() */
     void renameTabsAfterRemove();
+    TermWidgetHolder * newHolder(const QString& wdir, const QString& shell_program, bool deferred);
 };
 
 #endif
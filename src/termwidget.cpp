@@ -2,21 +2,51 @@
 #include <QVBoxLayout>
 #include <QPainter>
 #include <QDesktopServices>
+#include <QLineEdit>
+#include <QCoreApplication>
 
 #include "termwidget.h"
+#include "mainwindow.h"
 #include "config.h"
 #include "properties.h"
+#include "startuptrace.h"
+#include "latencyprobe.h"
+#include "scrollbackbudget.h"
+#include "scrollbackarchive.h"
+#include "historydialog.h"
+#include "sessionlog.h"
+#include "renderthrottle.h"
+#include "activitymonitor.h"
+#include "inputbroadcaster.h"
+#include "fontcache.h"
 
 static int TermWidgetCount = 0;
 
+//! TerminalDisplay's limit for zooming out
+static const int MINIMUM_FONT_SIZE = 6;
 
-TermWidgetImpl::TermWidgetImpl(const QString & wdir, const QString & shell, QWidget * parent)
-    : QTermWidget(0, parent)
+
+TermWidgetImpl::TermWidgetImpl(const QString & wdir, const QString & shell, QWidget * parent,
+                               const QStringList & args)
+    : QTermWidget(0, parent),
+      m_display(0),
+      m_archive(0),
+      m_log(0),
+      m_outputCount(0),
+      m_command(shell)
 {
     TermWidgetCount++;
     QString name("TermWidget_%1");
     setObjectName(name.arg(TermWidgetCount));
 
+    // the display is private to qtermwidget - the probes, the throttle
+    // and the broadcaster need its events
+    foreach (QWidget * w, findChildren<QWidget*>())
+    {
+        if (w->inherits("Konsole::TerminalDisplay"))
+            m_display = w;
+    }
+
     setFlowControlEnabled(FLOW_CONTROL_ENABLED);
     setFlowControlWarningEnabled(FLOW_CONTROL_WARNING_ENABLED);
 
@@ -32,6 +62,12 @@ TermWidgetImpl::TermWidgetImpl(const QString & wdir, const QString & shell, QWid
         if (!Properties::Instance()->shell.isNull())
             setShellProgram(Properties::Instance()->shell);
     }
+    else if (!args.isEmpty())
+    {
+        // eg. a path with spaces
+        setShellProgram(shell);
+        setArgs(args);
+    }
     else
     {
         qDebug() << "Settings custom shell program:" << shell;
@@ -51,70 +87,255 @@ TermWidgetImpl::TermWidgetImpl(const QString & wdir, const QString & shell, QWid
 
     connect(this, SIGNAL(urlActivated(QUrl)), this, SLOT(activateUrl(const QUrl&)));
 
+    if (LatencyProbe::isEnabled())
+        new LatencyProbe(this);
+
+    ScrollbackBudget::Instance()->addTerminal(this);
+    RenderThrottle::Instance()->addTerminal(this);
+
+    // receivedData() is not available in older qtermwidget
+    if (metaObject()->indexOfSignal("receivedData(QString)") != -1)
+        connect(this, SIGNAL(receivedData(QString)), this, SLOT(countOutput()));
+    ActivityMonitor::Instance()->addTerminal(this);
+
+    TraceSpan trace("shell spawn");
     startShellProgram();
 }
 
-void TermWidgetImpl::propertiesChanged()
+TermWidgetImpl::~TermWidgetImpl()
 {
-    setColorScheme(Properties::Instance()->colorScheme);
-    setTerminalFont(Properties::Instance()->font);
-    setMotionAfterPasting(Properties::Instance()->m_motionAfterPaste);
+    ScrollbackBudget::Instance()->removeTerminal(this);
+    RenderThrottle::Instance()->removeTerminal(this);
+    ActivityMonitor::Instance()->removeTerminal(this);
+    InputBroadcaster::Instance()->removeTerminal(this);
+    delete m_archive;
+    delete m_log;
+}
 
-    if (Properties::Instance()->historyLimited)
+void TermWidgetImpl::propertiesChanged(Properties::Changes changes)
+{
+    // each of these is expensive (font metrics, scheme files, history
+    // buffer reallocation) so touch only what has been changed
+    if (changes & Properties::ColorScheme)
+        setColorScheme(Properties::Instance()->colorScheme);
+    if (changes & Properties::TerminalFont)
+        setTerminalFont(FontCache::Instance()->font(Properties::Instance()->font, this));
+    if (changes & Properties::MotionAfterPaste)
+        setMotionAfterPasting(Properties::Instance()->m_motionAfterPaste);
+
+    if (changes & Properties::History)
     {
-        setHistorySize(Properties::Instance()->historyLimitedTo);
+        // the archive is what "Find in All Tabs" searches. It compresses
+        // all the output in the GUI thread so it's not on by default
+        bool archived = false;
+        if (Properties::Instance()->archiveHistory)
+            archived = startArchive();
+        else
+            stopArchive();
+        if (archived)
+            m_archive->setLineLimit(Properties::Instance()->historyLimited
+                                    ? Properties::Instance()->historyLimitedTo : 0);
+
+        if (ScrollbackBudget::Instance()->isEnabled())
+        {
+            // shared by all terminals
+            ScrollbackBudget::Instance()->scheduleRebalance();
+        }
+        else if (Properties::Instance()->historyLimited)
+        {
+            setHistorySize(Properties::Instance()->historyLimitedTo);
+        }
+        else if (archived && Properties::Instance()->archiveRecentLines > 0)
+        {
+            // the archive is the unlimited history - qtermwidget's
+            // uncompressed temporary files would keep all of it again
+            setHistorySize(Properties::Instance()->archiveRecentLines);
+        }
+        else
+        {
+            // Unlimited history in qtermwidget's temporary files
+            setHistorySize(-1);
+        }
     }
-    else
+
+    if (changes & Properties::SessionLogging)
     {
-        // Unlimited history
-        setHistorySize(-1);
+        // a new file with the new settings
+        stopLog();
+        if (Properties::Instance()->sessionLogMode != SessionLog::Off)
+            startLog();
     }
 
-    qDebug() << "TermWidgetImpl::propertiesChanged" << this << "emulation:" << Properties::Instance()->emulation;
-    setKeyBindings(Properties::Instance()->emulation);
-    setTerminalOpacity(1.0 - Properties::Instance()->termTransparency/100.0);
-
-    /* be consequent with qtermwidget.h here */
-    switch(Properties::Instance()->scrollBarPos) {
-    case 0:
-        setScrollBarPosition(QTermWidget::NoScrollBar);
-        break;
-    case 1:
-        setScrollBarPosition(QTermWidget::ScrollBarLeft);
-        break;
-    case 2:
-    default:
-        setScrollBarPosition(QTermWidget::ScrollBarRight);
-        break;
+    if (changes & Properties::Emulation)
+    {
+        qDebug() << "TermWidgetImpl::propertiesChanged" << this << "emulation:" << Properties::Instance()->emulation;
+        setKeyBindings(Properties::Instance()->emulation);
     }
+    if (changes & Properties::TerminalTransparency)
+        setTerminalOpacity(1.0 - Properties::Instance()->termTransparency/100.0);
 
-    update();
+    if (changes & Properties::ScrollBarPosition)
+    {
+        /* be consequent with qtermwidget.h here */
+        switch(Properties::Instance()->scrollBarPos) {
+        case 0:
+            setScrollBarPosition(QTermWidget::NoScrollBar);
+            break;
+        case 1:
+            setScrollBarPosition(QTermWidget::ScrollBarLeft);
+            break;
+        case 2:
+        default:
+            setScrollBarPosition(QTermWidget::ScrollBarRight);
+            break;
+        }
+    }
+
+    if (changes & Properties::TerminalChanges)
+        update();
+}
+
+bool TermWidgetImpl::startArchive()
+{
+    if (m_archive)
+        return true;
+
+    // receivedData() is not available in older qtermwidget
+    if (metaObject()->indexOfSignal("receivedData(QString)") == -1)
+        return false;
+
+    m_archive = new ScrollbackArchive();
+    if (!m_archive->isValid())
+    {
+        delete m_archive;
+        m_archive = 0;
+        return false;
+    }
+    connect(this, SIGNAL(receivedData(QString)), this, SLOT(archiveOutput(const QString &)));
+    return true;
+}
+
+void TermWidgetImpl::stopArchive()
+{
+    if (!m_archive)
+        return;
+    disconnect(this, SIGNAL(receivedData(QString)), this, SLOT(archiveOutput(const QString &)));
+    // HistoryDialog lets it go first
+    emit archiveStopped();
+    delete m_archive;
+    m_archive = 0;
+}
+
+void TermWidgetImpl::archiveOutput(const QString & data)
+{
+    m_archive->appendOutput(data);
+}
+
+void TermWidgetImpl::startLog()
+{
+    // receivedData() is not available in older qtermwidget
+    if (metaObject()->indexOfSignal("receivedData(QString)") == -1)
+    {
+        qDebug() << "TermWidgetImpl: session logging needs a newer qtermwidget";
+        return;
+    }
+    m_log = new SessionLog(objectName());
+    connect(this, SIGNAL(receivedData(QString)), this, SLOT(logOutput(const QString &)));
+}
+
+void TermWidgetImpl::stopLog()
+{
+    if (!m_log)
+        return;
+    disconnect(this, SIGNAL(receivedData(QString)), this, SLOT(logOutput(const QString &)));
+    delete m_log;
+    m_log = 0;
+}
+
+void TermWidgetImpl::logOutput(const QString & data)
+{
+    m_log->append(data);
+}
+
+void TermWidgetImpl::countOutput()
+{
+    // no more than this per chunk - ActivityMonitor samples it
+    ++m_outputCount;
+}
+
+void TermWidgetImpl::showSearch(const QString & text)
+{
+    // qtermwidget has no API for it - fill in its search bar
+    QWidget * bar = 0;
+    foreach (QWidget * w, findChildren<QWidget*>())
+    {
+        if (w->inherits("SearchBar"))
+            bar = w;
+    }
+    if (!bar)
+        return;
+
+    if (!bar->isVisible())
+        toggleShowSearchBar();
+    QLineEdit * edit = bar->findChild<QLineEdit*>();
+    if (edit)
+        edit->setText(text);
+}
+
+void TermWidgetImpl::showFullHistory()
+{
+    HistoryDialog *dlg = new HistoryDialog(this);
+    dlg->show();
 }
 
 void TermWidgetImpl::customContextMenuCall(const QPoint & pos)
 {
+    // actions are owned by the window this terminal lives in
+    MainWindow *mw = qobject_cast<MainWindow*>(window());
+    if (!mw)
+        return;
+
     QMenu menu;
-    menu.addAction(Properties::Instance()->actions[COPY_SELECTION]);
-    menu.addAction(Properties::Instance()->actions[PASTE_CLIPBOARD]);
-    menu.addAction(Properties::Instance()->actions[PASTE_SELECTION]);
-    menu.addAction(Properties::Instance()->actions[ZOOM_IN]);
-    menu.addAction(Properties::Instance()->actions[ZOOM_OUT]);
-    menu.addAction(Properties::Instance()->actions[ZOOM_RESET]);
+    menu.addAction(mw->action(ActionRegistry::CopySelection));
+    menu.addAction(mw->action(ActionRegistry::PasteClipboard));
+    menu.addAction(mw->action(ActionRegistry::PasteSelection));
+    menu.addAction(mw->action(ActionRegistry::ZoomIn));
+    menu.addAction(mw->action(ActionRegistry::ZoomOut));
+    menu.addAction(mw->action(ActionRegistry::ZoomReset));
     menu.addSeparator();
-    menu.addAction(Properties::Instance()->actions[CLEAR_TERMINAL]);
-    menu.addAction(Properties::Instance()->actions[SPLIT_HORIZONTAL]);
-    menu.addAction(Properties::Instance()->actions[SPLIT_VERTICAL]);
+    menu.addAction(mw->action(ActionRegistry::ClearTerminal));
+    if (m_archive)
+        menu.addAction(tr("Full History..."), this, SLOT(showFullHistory()));
+    menu.addAction(mw->action(ActionRegistry::SplitHorizontal));
+    menu.addAction(mw->action(ActionRegistry::SplitVertical));
 #warning TODO/FIXME: disable the action when there is only one terminal
-    menu.addAction(Properties::Instance()->actions[SUB_COLLAPSE]);
+    menu.addAction(mw->action(ActionRegistry::SubCollapse));
+    menu.addAction(mw->action(ActionRegistry::SynchronizeInput));
     menu.addSeparator();
-    menu.addAction(Properties::Instance()->actions[TOGGLE_MENU]);
-    menu.addAction(Properties::Instance()->actions[PREFERENCES]);
+    menu.addAction(mw->action(ActionRegistry::ToggleMenu));
+    menu.addAction(mw->action(ActionRegistry::Preferences));
     menu.exec(mapToGlobal(pos));
 }
 
+void TermWidgetImpl::zoom(int step)
+{
+    QFont font = getTerminalFont();
+    if (font.pointSize() <= 0)
+    {
+        // a pixel sized font - qtermwidget knows how to zoom it
+        if (step > 0)
+            emit QTermWidget::zoomIn();
+        else
+            emit QTermWidget::zoomOut();
+        return;
+    }
+    font.setPointSize(qMax(font.pointSize() + step, MINIMUM_FONT_SIZE));
+    setTerminalFont(FontCache::Instance()->font(font, this));
+}
+
 void TermWidgetImpl::zoomIn()
 {
-    emit QTermWidget::zoomIn();
+    zoom(1);
 // note: do not save zoom here due the #74 Zoom reset option resets font back to Monospace
 //    Properties::Instance()->font = getTerminalFont();
 //    Properties::Instance()->saveSettings();
@@ -122,7 +343,7 @@ void TermWidgetImpl::zoomIn()
 
 void TermWidgetImpl::zoomOut()
 {
-    emit QTermWidget::zoomOut();
+    zoom(-1);
 // note: do not save zoom here due the #74 Zoom reset option resets font back to Monospace
 //    Properties::Instance()->font = getTerminalFont();
 //    Properties::Instance()->saveSettings();
@@ -132,7 +353,10 @@ void TermWidgetImpl::zoomReset()
 {
 // note: do not save zoom here due the #74 Zoom reset option resets font back to Monospace
 //    Properties::Instance()->font = Properties::Instance()->font;
-    setTerminalFont(Properties::Instance()->font);
+    QFont font = FontCache::Instance()->font(Properties::Instance()->font, this);
+    // not zoomed - nothing to measure and lay out again
+    if (getTerminalFont() != font)
+        setTerminalFont(font);
 //    Properties::Instance()->saveSettings();
 }
 
@@ -154,21 +378,53 @@ TermWidget::TermWidget(const QString & wdir, const QString & shell, QWidget * pa
 
     m_layout->addWidget(m_term);
 
-    propertiesChanged();
+    // TermWidgetImpl has applied the rest already
+    propertiesChanged(Properties::HighlightCurrentTerminal);
 
     connect(m_term, SIGNAL(finished()), this, SIGNAL(finished()));
     connect(m_term, SIGNAL(termGetFocus()), this, SLOT(term_termGetFocus()));
     connect(m_term, SIGNAL(termLostFocus()), this, SLOT(term_termLostFocus()));
+
+    // the terminal contents are painted by the display, not by us
+    if (StartupTrace::isEnabled() && m_term->display())
+        m_term->display()->installEventFilter(this);
 }
 
-void TermWidget::propertiesChanged()
+bool TermWidget::eventFilter(QObject * obj, QEvent * event)
 {
-    if (Properties::Instance()->highlightCurrentTerminal)
-        m_layout->setContentsMargins(2, 2, 2, 2);
-    else
-        m_layout->setContentsMargins(0, 0, 0, 0);
+    if (event->type() != QEvent::Paint)
+        return false;
+
+    // once - the display is painted with every change of its contents
+    obj->removeEventFilter(this);
+    // another terminal has been painted first
+    if (!StartupTrace::isEnabled())
+        return false;
+
+    // the filter sees the event before the display - deliver it now
+    // (still inside the repaint) to know when the painting ends
+    qint64 paintBegin = StartupTrace::now();
+    QCoreApplication::sendEvent(obj, event);
+    qint64 paintEnd = StartupTrace::now();
+
+    // the first terminal on screen is the end of the startup
+    StartupTrace::addSpan("TermWidget first paint", paintBegin, paintEnd);
+    StartupTrace::addSpan("startup", 0, paintEnd);
+    StartupTrace::finish();
+    return true;
+}
+
+void TermWidget::propertiesChanged(Properties::Changes changes)
+{
+    if (changes & Properties::HighlightCurrentTerminal)
+    {
+        if (Properties::Instance()->highlightCurrentTerminal)
+            m_layout->setContentsMargins(2, 2, 2, 2);
+        else
+            m_layout->setContentsMargins(0, 0, 0, 0);
+    }
 
-    m_term->propertiesChanged();
+    m_term->propertiesChanged(changes);
 }
 
 void TermWidget::term_termGetFocus()
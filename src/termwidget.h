@@ -5,6 +5,10 @@
 
 #include <QAction>
 
+#include "properties.h"
+
+class ScrollbackArchive;
+class SessionLog;
 
 class TermWidgetImpl : public QTermWidget
 {
@@ -14,21 +18,57 @@ class TermWidgetImpl : public QTermWidget
 
     public:
 
-        TermWidgetImpl(const QString & wdir, const QString & shell=QString(), QWidget * parent=0);
-        void propertiesChanged();
+        /*! \a shell is split at whitespace into the program and its
+            arguments. With \a args it is the program path as it is.
+         */
+        TermWidgetImpl(const QString & wdir, const QString & shell=QString(), QWidget * parent=0,
+                       const QStringList & args=QStringList());
+        ~TermWidgetImpl();
+        void propertiesChanged(Properties::Changes changes = Properties::AllChanges);
+
+        //! Text copy of the history, 0 with an older qtermwidget
+        ScrollbackArchive * archive() { return m_archive; }
+        //! Open the search bar with \a text
+        void showSearch(const QString & text);
+        //! Bumped for each chunk of output, see ActivityMonitor
+        quint32 outputCount() const { return m_outputCount; }
+        //! Shell command it has been started with, empty for the default shell
+        QString command() const { return m_command; }
+        //! qtermwidget's Konsole::TerminalDisplay, 0 if it has none
+        QWidget * display() const { return m_display; }
 
     signals:
         void renameSession();
         void removeCurrentSession();
+        //! archive() is about to be deleted
+        void archiveStopped();
 
     public slots:
         void zoomIn();
         void zoomOut();
         void zoomReset();
 
+    private:
+        QWidget * m_display;
+        ScrollbackArchive * m_archive;
+        SessionLog * m_log;
+        quint32 m_outputCount;
+        QString m_command;
+
+        //! zoom by \a step points through FontCache
+        void zoom(int step);
+        bool startArchive();
+        void stopArchive();
+        void startLog();
+        void stopLog();
+
     private slots:
         void customContextMenuCall(const QPoint & pos);
         void activateUrl(const QUrl& url);
+        void archiveOutput(const QString & data);
+        void logOutput(const QString & data);
+        void countOutput();
+        void showFullHistory();
 };
 
 
@@ -43,7 +83,7 @@ class TermWidget : public QWidget
     public:
         TermWidget(const QString & wdir, const QString & shell=QString(), QWidget * parent=0);
 
-        void propertiesChanged(); 
+        void propertiesChanged(Properties::Changes changes = Properties::AllChanges);
         QStringList availableKeyBindings() { return m_term->availableKeyBindings(); }
 
         TermWidgetImpl * impl() { return m_term; }
@@ -61,6 +101,8 @@ class TermWidget : public QWidget
 
     protected:
         void paintEvent (QPaintEvent * event);
+        //! --trace-startup: times the first paint of the terminal display
+        bool eventFilter(QObject * obj, QEvent * event);
 
     private slots:
         void term_termGetFocus();
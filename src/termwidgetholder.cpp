@@ -1,157 +1,324 @@
 #include <QGridLayout>
 #include <QSplitter>
-#include <QInputDialog>
 
 #include "termwidgetholder.h"
 #include "termwidget.h"
+#include "termwidgetpool.h"
+#include "inputbroadcaster.h"
 #include "properties.h"
 #include <assert.h>
 
 
-TermWidgetHolder::TermWidgetHolder(const QString & wdir, const QString & shell, QWidget * parent)
+//! the last id given to a holder - unique in the process
+static int s_lastId = 0;
+
+
+TermWidgetHolder::TermWidgetHolder(const QString & wdir, const QString & shell, QWidget * parent,
+                                   bool deferred)
     : QWidget(parent),
+      m_id(++s_lastId),
       m_wdir(wdir),
       m_shell(shell),
-      m_currentTerm(0)
+      m_currentTerm(0),
+      m_materialized(false),
+      m_synchronizeInput(false),
+      m_hasLayout(false),
+      m_root(0),
+      m_first(0)
 {
     setFocusPolicy(Qt::NoFocus);
     QGridLayout * lay = new QGridLayout(this);
     lay->setSpacing(0);
     lay->setContentsMargins(0, 0, 0, 0);
 
+    setLayout(lay);
+
+    if (!deferred)
+        materialize();
+}
+
+void TermWidgetHolder::materialize()
+{
+    if (m_materialized)
+        return;
+    m_materialized = true;
+
     QSplitter *s = new QSplitter(this);
     s->setFocusPolicy(Qt::NoFocus);
-    TermWidget *w = newTerm();
-    s->addWidget(w);
-    lay->addWidget(s);
-
-    setLayout(lay);
+    m_root = new Node(0, s);
+    if (m_hasLayout)
+    {
+        // a restored session - all of it in one go
+        setUpdatesEnabled(false);
+        buildLayout(m_layout, m_root);
+        m_hasLayout = false;
+        m_layout = SessionState::Node();
+        setUpdatesEnabled(true);
+    }
+    else
+    {
+        TermWidget *w = newTerm();
+        s->addWidget(w);
+        addPane(m_root, w);
+    }
+    layout()->addWidget(s);
 }
 
 TermWidgetHolder::~TermWidgetHolder()
 {
+    // the widgets are deleted by Qt
+    deleteTree(m_root);
 }
 
-void TermWidgetHolder::setInitialFocus()
+QWidget * TermWidgetHolder::Node::widget() const
 {
-    QList<TermWidget*> list = findChildren<TermWidget*>();
-    TermWidget * w = list.count() == 0 ? 0 : list.at(0);
-    if (w)
-        w->setFocus(Qt::OtherFocusReason);
+    if (splitter)
+        return splitter;
+    return term;
 }
 
-void TermWidgetHolder::loadSession()
+void TermWidgetHolder::deleteTree(Node * node)
 {
-    bool ok;
-    QString name = QInputDialog::getItem(this, tr("Load Session"),
-                                         tr("List of saved sessions:"),
-                                         Properties::Instance()->sessions.keys(),
-                                         0, false, &ok);
-    if (!ok || name.isEmpty())
+    if (!node)
         return;
-#if 0
-    foreach (QWidget * w, findChildren<QWidget*>())
-    {
-        if (w)
-        {
-            delete w;
-            w = 0;
-        }
-    }
+    foreach (Node * child, node->children)
+        deleteTree(child);
+    delete node;
+}
+
+TermWidgetHolder::Node * TermWidgetHolder::addPane(Node * parent, TermWidget * term, Node * after)
+{
+    Node * pane = new Node(parent, 0, term);
+    parent->children.append(pane);
+    m_panes[term] = pane;
 
-    qDebug() << "load" << name << QString(Properties::Instance()->sessions[name]);
-    QStringList splitters = QString(Properties::Instance()->sessions[name]).split("|", QString::SkipEmptyParts);
-    foreach (QString splitter, splitters)
+    if (!m_first)
     {
-        QStringList components = splitter.split(",");
-        qDebug() << "comp" << components;
-        // orientation
-        Qt::Orientation orientation;
-        if (components.size() > 0)
-            orientation = components.takeAt(0).toInt();
-        // sizes
-        QList<int> sizes;
-        QList<TermWidget*> widgets;
-        foreach (QString s, components)
-        {
-            sizes << s.toInt();
-            widgets << newTerm();
-        }
-        // new terms
+        pane->next = pane;
+        pane->prev = pane;
+        m_first = pane;
+        return pane;
     }
-#endif
+    if (!after)
+        after = m_first->prev;
+    pane->prev = after;
+    pane->next = after->next;
+    after->next->prev = pane;
+    after->next = pane;
+    return pane;
 }
 
-void TermWidgetHolder::saveSession(const QString & name)
+void TermWidgetHolder::unlinkPane(Node * pane)
 {
-    Session dump;
-    QString num("%1");
-    foreach(QSplitter *w, findChildren<QSplitter*>())
+    m_panes.remove(pane->term);
+    if (pane->next == pane)
+    {
+        m_first = 0;
+    }
+    else
     {
-        dump += '|' + num.arg(w->orientation());
-        foreach (int i, w->sizes())
-            dump += ',' + num.arg(i);
+        pane->prev->next = pane->next;
+        pane->next->prev = pane->prev;
+        if (m_first == pane)
+            m_first = pane->next;
     }
-    Properties::Instance()->sessions[name] = dump;
-    qDebug() << "dump" << dump;
+    pane->next = 0;
+    pane->prev = 0;
 }
 
-TermWidget* TermWidgetHolder::currentTerminal()
+void TermWidgetHolder::setInitialFocus()
 {
-    return m_currentTerm;
+    if (m_first)
+        m_first->term->setFocus(Qt::OtherFocusReason);
 }
 
-void TermWidgetHolder::setWDir(const QString & wdir)
+SessionState::Node TermWidgetHolder::layoutState()
 {
-    m_wdir = wdir;
+    if (!m_materialized)
+    {
+        if (m_hasLayout)
+            return m_layout;
+        SessionState::Node pane;
+        pane.wdir = m_wdir;
+        pane.command = m_shell;
+        return pane;
+    }
+
+    if (!m_root)
+        return SessionState::Node();
+    return nodeState(m_root);
 }
 
-void TermWidgetHolder::switchNextSubterminal()
+SessionState::Node TermWidgetHolder::nodeState(Node * node)
 {
-    // TODO/FIXME: merge switchPrevSubterminal with switchNextSubterminal
-    QList<TermWidget*> l = findChildren<TermWidget*>();
-    int ix = -1;
-    foreach (TermWidget * w, l)
+    SessionState::Node state;
+    if (node->term)
     {
-        ++ix;
-        if (w->impl()->hasFocus())
-        {
-            break;
-        }
+        state.wdir = node->term->impl()->workingDirectory();
+        if (state.wdir.isEmpty())
+            state.wdir = m_wdir;
+        state.command = node->term->impl()->command();
+        return state;
     }
 
-    if (ix < l.count()-1)
+    if (node->children.isEmpty())
+        return state;
+    // split() nests a splitter for each split - one child ones are not needed
+    if (node->children.count() == 1)
+        return nodeState(node->children.first());
+
+    state.vertical = node->splitter->orientation() == Qt::Vertical;
+    state.sizes = node->splitter->sizes();
+    foreach (Node * child, node->children)
+        state.children.append(nodeState(child));
+    return state;
+}
+
+void TermWidgetHolder::setLayoutState(const SessionState::Node & layout)
+{
+    m_hasLayout = true;
+    m_layout = layout;
+}
+
+void TermWidgetHolder::buildLayout(const SessionState::Node & node, Node * parent)
+{
+    if (node.isPane())
     {
-        l.at(ix+1)->impl()->setFocus(Qt::OtherFocusReason);
+        // the pool is for the default directory and shell only
+        TermWidget * term = newTerm(node.wdir, node.command, false);
+        parent->splitter->addWidget(term);
+        addPane(parent, term);
+        return;
     }
-    else if (ix == l.count()-1)
+
+    QSplitter * s = new QSplitter(node.vertical ? Qt::Vertical : Qt::Horizontal, this);
+    s->setFocusPolicy(Qt::NoFocus);
+    parent->splitter->addWidget(s);
+    Node * n = new Node(parent, s);
+    parent->children.append(n);
+    foreach (const SessionState::Node & child, node.children)
+        buildLayout(child, n);
+    if (node.sizes.count() == node.children.count())
+        s->setSizes(node.sizes);
+}
+
+TermWidget* TermWidgetHolder::currentTerminal()
+{
+    return m_currentTerm;
+}
+
+QList<TermWidget*> TermWidgetHolder::terminals() const
+{
+    QList<TermWidget*> ret;
+    if (!m_first)
+        return ret;
+    Node * pane = m_first;
+    do {
+        ret.append(pane->term);
+        pane = pane->next;
+    } while (pane != m_first);
+    return ret;
+}
+
+TermWidgetHolder::Node * TermWidgetHolder::currentPane()
+{
+    Node * pane = m_panes.value(m_currentTerm);
+    return pane ? pane : m_first;
+}
+
+void TermWidgetHolder::setSynchronizeInput(bool enable)
+{
+    m_synchronizeInput = enable;
+    foreach (TermWidget * w, terminals())
     {
-        l.at(0)->impl()->setFocus(Qt::OtherFocusReason);
+        if (enable)
+            InputBroadcaster::Instance()->addTerminal(w->impl());
+        else
+            InputBroadcaster::Instance()->removeTerminal(w->impl());
     }
 }
 
+void TermWidgetHolder::setWDir(const QString & wdir)
+{
+    m_wdir = wdir;
+}
+
+void TermWidgetHolder::switchNextSubterminal()
+{
+    Node * pane = currentPane();
+    if (pane)
+        pane->next->term->impl()->setFocus(Qt::OtherFocusReason);
+}
+
 void TermWidgetHolder::switchPrevSubterminal()
 {
-    // TODO/FIXME: merge switchPrevSubterminal with switchNextSubterminal
-    QList<TermWidget*> l = findChildren<TermWidget*>();
-    int ix = -1;
-    foreach (TermWidget * w, l)
-    {
-        ++ix;
-        if (w->impl()->hasFocus())
-        {
-            break;
-        }
-    }
+    Node * pane = currentPane();
+    if (pane)
+        pane->prev->term->impl()->setFocus(Qt::OtherFocusReason);
+}
+
+//! How far is \a value from the \a low - \a high range
+static int distance(int value, int low, int high)
+{
+    if (value < low)
+        return low - value;
+    if (value > high)
+        return value - high;
+    return 0;
+}
+
+void TermWidgetHolder::switchSubterminal(Direction direction)
+{
+    Node * pane = currentPane();
+    if (!pane)
+        return;
+    Qt::Orientation orientation = (direction == Left || direction == Right) ? Qt::Horizontal : Qt::Vertical;
+    int step = (direction == Left || direction == Up) ? -1 : 1;
 
-    if (ix > 0)
+    // the closest splitter with something on that side of us
+    Node * target = 0;
+    for (Node * n = pane; n->parent && !target; n = n->parent)
     {
-        l.at(ix-1)->impl()->setFocus(Qt::OtherFocusReason);
+        Node * parent = n->parent;
+        if (parent->splitter->orientation() != orientation)
+            continue;
+        int ix = parent->children.indexOf(n) + step;
+        if (ix >= 0 && ix < parent->children.count())
+            target = parent->children.at(ix);
     }
-    else if (ix == 0)
+
+    // down to the pane which is next to the current one
+    QPoint center = pane->term->mapTo(this, pane->term->rect().center());
+    while (target && !target->term)
     {
-        l.at(l.count()-1)->impl()->setFocus(Qt::OtherFocusReason);
+        if (target->splitter->orientation() == orientation)
+        {
+            if (target->children.isEmpty())
+                return;
+            target = step > 0 ? target->children.first() : target->children.last();
+            continue;
+        }
+
+        Node * best = 0;
+        int bestDistance = 0;
+        foreach (Node * child, target->children)
+        {
+            QWidget * w = child->widget();
+            QPoint topLeft = w->mapTo(this, QPoint(0, 0));
+            int d = orientation == Qt::Horizontal
+                    ? distance(center.y(), topLeft.y(), topLeft.y() + w->height())
+                    : distance(center.x(), topLeft.x(), topLeft.x() + w->width());
+            if (!best || d < bestDistance)
+            {
+                best = child;
+                bestDistance = d;
+            }
+        }
+        target = best;
     }
+
+    if (target)
+        target->term->impl()->setFocus(Qt::OtherFocusReason);
 }
 
 void TermWidgetHolder::clearActiveTerminal()
@@ -159,10 +326,10 @@ void TermWidgetHolder::clearActiveTerminal()
     currentTerminal()->impl()->clear();
 }
 
-void TermWidgetHolder::propertiesChanged()
+void TermWidgetHolder::propertiesChanged(Properties::Changes changes)
 {
-    foreach(TermWidget *w, findChildren<TermWidget*>())
-        w->propertiesChanged();
+    foreach(TermWidget *w, terminals())
+        w->propertiesChanged(changes);
 }
 
 void TermWidgetHolder::splitHorizontal(TermWidget * term)
@@ -177,27 +344,36 @@ void TermWidgetHolder::splitVertical(TermWidget * term)
 
 void TermWidgetHolder::splitCollapse(TermWidget * term)
 {
-    QSplitter * parent = qobject_cast<QSplitter*>(term->parent());
-    assert(parent);
+    Node * pane = m_panes.value(term);
+    assert(pane);
+    // the previous one is usually the one it has been split from
+    Node * neighbour = pane->next != pane ? pane->prev : 0;
+    unlinkPane(pane);
+    Node * parent = pane->parent;
+    parent->children.removeAll(pane);
+    delete pane;
+
+    if (m_currentTerm == term)
+        m_currentTerm = 0;
     term->setParent(0);
     delete term;
 
-    int cnt = parent->findChildren<TermWidget*>().count();
-    if (cnt == 0)
+    // no empty splitters - except the top one
+    while (parent != m_root && parent->children.isEmpty())
     {
-        parent->setParent(0);
+        Node * up = parent->parent;
+        up->children.removeAll(parent);
+        parent->splitter->setParent(0);
+        delete parent->splitter;
         delete parent;
+        parent = up;
     }
 
-    QList<TermWidget*> tlist = findChildren<TermWidget *>();
-    int localCnt = tlist.count();
-
-    if (localCnt > 0)
+    if (neighbour)
     {
-        tlist.at(0)->setFocus(Qt::OtherFocusReason);
+        neighbour->term->setFocus(Qt::OtherFocusReason);
         update();
-        if (parent)
-            parent->update();
+        parent->splitter->update();
     }
     else
         emit finished();
@@ -205,8 +381,9 @@ void TermWidgetHolder::splitCollapse(TermWidget * term)
 
 void TermWidgetHolder::split(TermWidget *term, Qt::Orientation orientation)
 {
-    QSplitter *parent = qobject_cast<QSplitter *>(term->parent());
-    assert(parent);
+    Node * pane = m_panes.value(term);
+    assert(pane);
+    QSplitter *parent = pane->parent->splitter;
 
     int ix = parent->indexOf(term);
     QList<int> parentSizes = parent->sizes();
@@ -234,10 +411,17 @@ void TermWidgetHolder::split(TermWidget *term, Qt::Orientation orientation)
     parent->insertWidget(ix, s);
     parent->setSizes(parentSizes);
 
+    // the same in the tree: the pane becomes a splitter with the new one after it
+    Node * node = new Node(pane->parent, s);
+    pane->parent->children[pane->parent->children.indexOf(pane)] = node;
+    pane->parent = node;
+    node->children.append(pane);
+    addPane(node, w, pane);
+
     w->setFocus(Qt::OtherFocusReason);
 }
 
-TermWidget *TermWidgetHolder::newTerm(const QString & wdir, const QString & shell)
+TermWidget *TermWidgetHolder::newTerm(const QString & wdir, const QString & shell, bool pooled)
 {
     QString wd(wdir);
     if (wd.isEmpty())
@@ -247,7 +431,11 @@ TermWidget *TermWidgetHolder::newTerm(const QString & wdir, const QString & shel
     if (shell.isEmpty())
         sh = m_shell;
 
-    TermWidget *w = new TermWidget(wd, sh, this);
+    TermWidget *w = pooled ? TermWidgetPool::Instance()->take(wd, sh) : 0;
+    if (w)
+        w->setParent(this);
+    else
+        w = new TermWidget(wd, sh, this);
     // proxy signals
     connect(w, SIGNAL(renameSession()), this, SIGNAL(renameSession()));
     connect(w, SIGNAL(removeCurrentSession()), this, SIGNAL(lastTerminalClosed()));
@@ -263,6 +451,9 @@ TermWidget *TermWidgetHolder::newTerm(const QString & wdir, const QString & shel
     connect(w, SIGNAL(termGetFocus(TermWidget *)),
             this, SLOT(setCurrentTerminal(TermWidget *)));
 
+    if (m_synchronizeInput)
+        InputBroadcaster::Instance()->addTerminal(w->impl());
+
     return w;
 }
 
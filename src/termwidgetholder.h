@@ -2,7 +2,9 @@
 #define TERMWIDGETHOLDER_H
 
 #include <QWidget>
+#include <QHash>
 #include "termwidget.h"
+#include "sessionstate.h"
 class QSplitter;
 
 
@@ -13,25 +15,63 @@ This widget (one per TabWidget tab) is a "proxy" widget beetween TabWidget and
 unspecified count of TermWidgets. Basically it should look like a single TermWidget
 for TabWidget - with its signals and slots.
 
-Splitting and collapsing of TermWidgets is done here.
+Splitting and collapsing of TermWidgets is done here. The QSplitters and
+TermWidgets are mirrored by a tree of Nodes; its panes are linked in a
+ring in their stable on-screen order (depth first) so the next/previous
+terminal is found without walking the widgets.
 */
 class TermWidgetHolder : public QWidget
 {
     Q_OBJECT
 
     public:
-        TermWidgetHolder(const QString & wdir, const QString & shell=QString(), QWidget * parent=0);
+        enum Direction {
+            Left = 0,
+            Right,
+            Up,
+            Down
+        };
+
+        /*! Deferred holder is just a placeholder keeping wdir and shell.
+            Its terminal is created by materialize() - TabWidget calls it
+            when the tab becomes current for the first time.
+         */
+        TermWidgetHolder(const QString & wdir, const QString & shell=QString(), QWidget * parent=0,
+                         bool deferred=false);
         ~TermWidgetHolder();
 
-        void propertiesChanged();
+        /*! Stable over the life of the tab - its index changes with every
+            move or close, the id does not. See TabWidget::holder().
+         */
+        int id() const { return m_id; }
+
+        bool isMaterialized() { return m_materialized; }
+        void materialize();
+
+        void propertiesChanged(Properties::Changes changes = Properties::AllChanges);
         void setInitialFocus();
 
-        void loadSession();
-        void saveSession(const QString & name);
+        //! Splitters and panes as they are now - or will be when materialized
+        SessionState::Node layoutState();
+        /*! Layout to build instead of the single terminal by materialize().
+            For deferred holders only.
+         */
+        void setLayoutState(const SessionState::Node & layout);
+
         void zoomIn(uint step);
         void zoomOut(uint step);
 
         TermWidget* currentTerminal();
+        //! All terminals in their order
+        QList<TermWidget*> terminals() const;
+        //! Focus the terminal next to the current one on the screen
+        void switchSubterminal(Direction direction);
+
+        /*! Keystrokes and pastes go to all terminals of this tab and of
+            the other synchronized tabs. See InputBroadcaster.
+         */
+        void setSynchronizeInput(bool enable);
+        bool synchronizeInput() const { return m_synchronizeInput; }
 
     public slots:
         void splitHorizontal(TermWidget * term);
@@ -48,12 +88,49 @@ class TermWidgetHolder : public QWidget
         void renameSession();
 
     private:
+        //! a QSplitter or a TermWidget (a pane)
+        struct Node
+        {
+            Node(Node * p = 0, QSplitter * s = 0, TermWidget * t = 0)
+                : parent(p), splitter(s), term(t), next(0), prev(0) {}
+            QWidget * widget() const;
+
+            Node * parent;
+            QSplitter * splitter;
+            TermWidget * term;
+            QList<Node*> children;
+            //! the ring of panes
+            Node * next;
+            Node * prev;
+        };
+
+        int m_id;
         QString m_wdir;
         QString m_shell;
         TermWidget * m_currentTerm;
+        bool m_materialized;
+        bool m_synchronizeInput;
+        //! see setLayoutState()
+        bool m_hasLayout;
+        SessionState::Node m_layout;
+
+        //! the top splitter
+        Node * m_root;
+        //! the first pane of the ring
+        Node * m_first;
+        QHash<TermWidget*, Node*> m_panes;
 
         void split(TermWidget * term, Qt::Orientation orientation);
-        TermWidget * newTerm(const QString & wdir=QString(), const QString & shell=QString());
+        TermWidget * newTerm(const QString & wdir=QString(), const QString & shell=QString(),
+                             bool pooled=true);
+        void buildLayout(const SessionState::Node & node, Node * parent);
+        SessionState::Node nodeState(Node * node);
+
+        Node * currentPane();
+        //! The last child of \a parent, after \a after in the ring (0 is the end)
+        Node * addPane(Node * parent, TermWidget * term, Node * after = 0);
+        void unlinkPane(Node * pane);
+        void deleteTree(Node * node);
 
     private slots:
         void setCurrentTerminal(TermWidget* term);
@@ -0,0 +1,110 @@
+
+#include <QApplication>
+#include <QDebug>
+
+#include "termwidgetpool.h"
+#include "termwidget.h"
+#include "properties.h"
+
+// delay between two spawns so refilling doesn't block the GUI
+#define REFILL_INTERVAL 200
+
+
+TermWidgetPool * TermWidgetPool::m_instance = 0;
+
+
+TermWidgetPool * TermWidgetPool::Instance()
+{
+    if (!m_instance)
+        m_instance = new TermWidgetPool();
+    return m_instance;
+}
+
+TermWidgetPool::TermWidgetPool()
+    : QObject(0)
+{
+    m_refillTimer.setSingleShot(true);
+    connect(&m_refillTimer, SIGNAL(timeout()), this, SLOT(refill()));
+    connect(qApp, SIGNAL(aboutToQuit()), this, SLOT(clear()));
+    connect(Properties::Instance(), SIGNAL(changed(Properties::Changes)),
+            this, SLOT(propertiesChanged(Properties::Changes)));
+}
+
+TermWidgetPool::~TermWidgetPool()
+{
+    clear();
+}
+
+TermWidget * TermWidgetPool::take(const QString & wdir, const QString & shell)
+{
+    if (Properties::Instance()->terminalPoolSize <= 0 || !shell.isEmpty())
+        return 0;
+
+    // the first request sets the directory the pool serves - the default
+    // work directory. Others (eg. with useCWD) start their own shell.
+    if (m_wdir.isNull())
+        m_wdir = wdir;
+    else if (wdir != m_wdir)
+        return 0;
+
+    scheduleRefill();
+    if (m_terms.isEmpty())
+        return 0;
+
+    TermWidget * w = m_terms.takeFirst();
+    disconnect(w, 0, this, 0);
+    return w;
+}
+
+void TermWidgetPool::propertiesChanged(Properties::Changes changes)
+{
+    if (changes & Properties::TerminalChanges)
+    {
+        foreach (TermWidget * w, m_terms)
+            w->propertiesChanged(changes);
+    }
+
+    while (m_terms.count() > qMax(0, Properties::Instance()->terminalPoolSize))
+        m_terms.takeLast()->deleteLater();
+
+    // refill() tops it up only - nothing to do if it is full
+    if (!m_wdir.isNull())
+        scheduleRefill();
+}
+
+void TermWidgetPool::scheduleRefill()
+{
+    if (!m_refillTimer.isActive())
+        m_refillTimer.start(REFILL_INTERVAL);
+}
+
+void TermWidgetPool::refill()
+{
+    if (m_terms.count() >= Properties::Instance()->terminalPoolSize)
+        return;
+
+    TermWidget * w = new TermWidget(m_wdir, QString(), 0);
+    connect(w, SIGNAL(finished()), this, SLOT(term_finished()));
+    m_terms.append(w);
+
+    if (m_terms.count() < Properties::Instance()->terminalPoolSize)
+        scheduleRefill();
+}
+
+void TermWidgetPool::clear()
+{
+    m_refillTimer.stop();
+    qDeleteAll(m_terms);
+    m_terms.clear();
+}
+
+void TermWidgetPool::term_finished()
+{
+    // shell died before anyone used it. Do not respawn it here to avoid
+    // a busy loop with broken shells - take() will schedule a refill.
+    TermWidget * w = qobject_cast<TermWidget*>(sender());
+    qDebug() << "TermWidgetPool: pooled terminal finished" << w;
+    m_terms.removeAll(w);
+    if (w)
+        w->deleteLater();
+}
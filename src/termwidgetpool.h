@@ -0,0 +1,55 @@
+#ifndef TERMWIDGETPOOL_H
+#define TERMWIDGETPOOL_H
+
+#include <QObject>
+#include <QTimer>
+
+#include "properties.h"
+
+class TermWidget;
+
+
+/*! \brief Pool of pre-started terminals.
+
+It keeps Properties::terminalPoolSize hidden TermWidgets with already
+running default shells so new tabs and splits don't have to wait
+for fork/exec and shell startup. The pool is refilled from a timer
+when the application is idle. It serves the work directory of the
+first request only - a terminal for another directory is not worth
+killing the pooled shells for.
+*/
+class TermWidgetPool : public QObject
+{
+    Q_OBJECT
+
+    public:
+        static TermWidgetPool *Instance();
+
+        /*! Take a running terminal. Returns 0 if the pool cannot serve
+            the request (custom shell, different work directory or
+            the pool is empty). The caller is responsible for reparenting.
+         */
+        TermWidget * take(const QString & wdir, const QString & shell);
+
+    public slots:
+        void propertiesChanged(Properties::Changes changes = Properties::AllChanges);
+
+    private:
+        static TermWidgetPool *m_instance;
+
+        QString m_wdir;
+        QList<TermWidget*> m_terms;
+        QTimer m_refillTimer;
+
+        TermWidgetPool();
+        ~TermWidgetPool();
+
+        void scheduleRefill();
+
+    private slots:
+        void refill();
+        void clear();
+        void term_finished();
+};
+
+#endif